@@ -3,6 +3,8 @@
 
 #include <fx_chain_configuration.h>
 #include <global_settings.h>
+#include <meter_levels.h>
+#include <trace_records.h>
 #include <functional>
 #include <cstdint>
 #include <memory>
@@ -18,18 +20,28 @@ class ConfigurationBackend
     using OnApplyConfigCallback = std::function<void(const FxChainConfiguration&)>;
     using OnGetConfigCallback = std::function<FxChainConfiguration()>;
     using OnSetParametersCallback = std::function<void(std::uint32_t, const std::vector<ParameterValue>&)>;
+    // Throws std::invalid_argument if any of the updates is invalid, in which
+    // case none of them is applied
+    using OnSetParameterBatchCallback = std::function<void(const ParameterUpdates&)>;
     using OnReloadCallback = std::function<void()>;
     using OnApplyGlobalSettingsCallback = std::function<void(const GlobalSettings&)>;
     using OnGetGlobalSettingsCallback = std::function<GlobalSettings()>;
+    using OnGetLevelsCallback = std::function<ChainLevels()>;
+    using OnStartTraceCallback = std::function<void()>;
+    using OnStopTraceCallback = std::function<Trace()>;
 
     virtual ~ConfigurationBackend() {}
     virtual void registerOnGetPlugins(const OnGetPluginsCallback& callback) = 0;
     virtual void registerOnApplyConfig(const OnApplyConfigCallback& callback) = 0;
     virtual void registerOnGetConfig(const OnGetConfigCallback& callback) = 0;
     virtual void registerOnSetParameters(const OnSetParametersCallback& callback) = 0;
+    virtual void registerOnSetParameterBatch(const OnSetParameterBatchCallback& callback) = 0;
     virtual void registerOnReload(const OnReloadCallback& callback) = 0;
     virtual void registerOnApplyGlobalSettings(const OnApplyGlobalSettingsCallback& callback) = 0;
     virtual void registerOnGetGlobalSettings(const OnGetGlobalSettingsCallback& callback) = 0;
+    virtual void registerOnGetLevels(const OnGetLevelsCallback& callback) = 0;
+    virtual void registerOnStartTrace(const OnStartTraceCallback& callback) = 0;
+    virtual void registerOnStopTrace(const OnStopTraceCallback& callback) = 0;
     virtual void start(std::uint32_t port) = 0;
 };
 
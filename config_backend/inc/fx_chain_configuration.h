@@ -3,6 +3,7 @@
 
 #include <string>
 #include <vector>
+#include <cstdint>
 
 namespace awesomefx
 {
@@ -12,10 +13,24 @@ struct FxConfiguration
 {
   std::string name;
   std::vector<ParameterValue> parameters;
+  // Other than two runs the slot as that many mono instances in lockstep
+  std::uint32_t channels = 2;
+  // Samples the slot delays the signal by, reported by the engine and
+  // ignored when a configuration is applied
+  std::uint32_t latency = 0;
 };
 
 using FxChainConfiguration = std::vector<FxConfiguration>;
 
+struct ParameterUpdate
+{
+  std::uint32_t slot;
+  std::uint32_t index;
+  ParameterValue value;
+};
+
+using ParameterUpdates = std::vector<ParameterUpdate>;
+
 struct AvailablePlugin
 {
   std::string name;
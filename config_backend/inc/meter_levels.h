@@ -0,0 +1,21 @@
+#ifndef METER_LEVELS_H
+#define METER_LEVELS_H
+
+#include <vector>
+
+namespace awesomefx
+{
+
+struct SlotLevels
+{
+  float peakLeft;
+  float peakRight;
+  float rmsLeft;
+  float rmsRight;
+};
+
+using ChainLevels = std::vector<SlotLevels>;
+
+}
+
+#endif /* METER_LEVELS_H */
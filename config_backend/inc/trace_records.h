@@ -0,0 +1,27 @@
+#ifndef TRACE_RECORDS_H
+#define TRACE_RECORDS_H
+
+#include <string>
+#include <vector>
+
+namespace awesomefx
+{
+
+struct TraceRecord
+{
+  // Static string owned by the engine
+  const char* name;
+  char phase;
+  double timestamp;
+  std::size_t track;
+};
+
+struct Trace
+{
+  std::vector<std::string> tracks;
+  std::vector<TraceRecord> records;
+};
+
+}
+
+#endif /* TRACE_RECORDS_H */
@@ -2,6 +2,7 @@
 #include <nlohmann/json.hpp>
 #include <algorithm>
 #include <http/param.hxx>
+#include <boost/asio/post.hpp>
 
 using namespace awesomefx;
 using json = nlohmann::json;
@@ -10,6 +11,78 @@ using pack = http::param::pack<int>;
 namespace
 {
 
+// Number of finished jobs kept around for polling
+const std::size_t MaxJobs = 64;
+
+// Matches the rate the engine produces meter frames at
+const std::uint32_t MeterFramesPerSecond = 30;
+
+enum class Encoding
+{
+  Json,
+  Cbor,
+  MsgPack
+};
+
+// Picks the first of the supported media types mentioned in a Content-Type
+// or Accept header, defaulting to JSON
+Encoding negotiate(beast::string_view header)
+{
+  auto first = beast::string_view::npos;
+  auto encoding = Encoding::Json;
+
+  auto consider = [&](beast::string_view type, Encoding candidate) {
+    auto pos = header.find(type);
+    if (pos < first)
+    {
+      first = pos;
+      encoding = candidate;
+    }
+  };
+
+  consider("application/json", Encoding::Json);
+  consider("application/cbor", Encoding::Cbor);
+  consider("application/msgpack", Encoding::MsgPack);
+  consider("application/x-msgpack", Encoding::MsgPack);
+
+  return encoding;
+}
+
+template<class RequestBody>
+json parse_body(const beast::http::request<RequestBody>& request)
+{
+  auto& body = request.body();
+  switch (negotiate(request[beast::http::field::content_type]))
+  {
+    case Encoding::Cbor:
+      return json::from_cbor(body.begin(), body.end());
+    case Encoding::MsgPack:
+      return json::from_msgpack(body.begin(), body.end());
+    case Encoding::Json:
+    default:
+      return json::parse(body);
+  }
+}
+
+template<class RequestBody>
+std::pair<std::string, beast::string_view>
+encode_body(const beast::http::request<RequestBody>& request, const json& body)
+{
+  std::string encoded;
+  switch (negotiate(request[beast::http::field::accept]))
+  {
+    case Encoding::Cbor:
+      json::to_cbor(body, encoded);
+      return {std::move(encoded), "application/cbor"};
+    case Encoding::MsgPack:
+      json::to_msgpack(body, encoded);
+      return {std::move(encoded), "application/msgpack"};
+    case Encoding::Json:
+    default:
+      return {body.dump(), "application/json"};
+  }
+}
+
 template<class ResponseBody, class RequestBody>
 beast::http::response<ResponseBody>
 make_200(const beast::http::request<RequestBody>& request,
@@ -27,6 +100,17 @@ make_200(const beast::http::request<RequestBody>& request,
     return response;
 }
 
+template<class ResponseBody, class RequestBody>
+beast::http::response<ResponseBody>
+make_200(const beast::http::request<RequestBody>& request, const json& body)
+{
+    auto encoded = encode_body(request, body);
+    auto response = make_200<ResponseBody>(request, std::move(encoded.first), encoded.second);
+    response.set(beast::http::field::vary, "Accept");
+
+    return response;
+}
+
 template<class ResponseBody, class RequestBody>
 beast::http::response<ResponseBody>
 make_404(const beast::http::request<RequestBody>& request,
@@ -42,10 +126,47 @@ make_404(const beast::http::request<RequestBody>& request,
 
     return response;
 }
+
+template<class ResponseBody, class RequestBody>
+beast::http::response<ResponseBody>
+make_400(const beast::http::request<RequestBody>& request,
+         typename ResponseBody::value_type body,
+         beast::string_view content)
+{
+    beast::http::response<ResponseBody> response{beast::http::status::bad_request, request.version()};
+    response.set(beast::http::field::server, BOOST_BEAST_VERSION_STRING);
+    response.set(beast::http::field::content_type, content);
+    response.set(beast::http::field::access_control_allow_origin, "*");
+    response.body() = body;
+    response.prepare_payload();
+    response.keep_alive(request.keep_alive());
+
+    return response;
+}
+
+template<class ResponseBody, class RequestBody>
+beast::http::response<ResponseBody>
+make_202(const beast::http::request<RequestBody>& request,
+         std::uint32_t job)
+{
+    auto body = encode_body(request, {{"job", job}, {"status", "pending"}});
+    beast::http::response<ResponseBody> response{beast::http::status::accepted, request.version()};
+    response.set(beast::http::field::server, BOOST_BEAST_VERSION_STRING);
+    response.set(beast::http::field::content_type, body.second);
+    response.set(beast::http::field::access_control_allow_origin, "*");
+    response.set(beast::http::field::location, "/jobs/" + std::to_string(job));
+    response.set(beast::http::field::vary, "Accept");
+    response.body() = std::move(body.first);
+    response.prepare_payload();
+    response.keep_alive(request.keep_alive());
+
+    return response;
+}
 }
 
-ConfigurationBackendImpl::ConfigurationBackendImpl(boost::asio::io_context& io)
+ConfigurationBackendImpl::ConfigurationBackendImpl(boost::asio::io_context& io, boost::asio::io_context& worker)
   : m_io(io)
+  , m_worker(worker)
 {
 }
 
@@ -69,6 +190,11 @@ void ConfigurationBackendImpl::registerOnSetParameters(const OnSetParametersCall
   m_setParameters = callback;
 }
 
+void ConfigurationBackendImpl::registerOnSetParameterBatch(const OnSetParameterBatchCallback& callback)
+{
+  m_setParameterBatch = callback;
+}
+
 void ConfigurationBackendImpl::registerOnReload(const OnReloadCallback& callback)
 {
   m_reload = callback;
@@ -84,6 +210,79 @@ void ConfigurationBackendImpl::registerOnGetGlobalSettings(const OnGetGlobalSett
   m_getGlobalSettings = callback;
 }
 
+std::uint32_t ConfigurationBackendImpl::submitJob(std::function<void()> work)
+{
+  std::uint32_t id;
+  {
+    std::lock_guard<std::mutex> lock(m_jobsMutex);
+    id = m_nextJobId++;
+    m_jobs[id] = {JobStatus::Pending, ""};
+    while (m_jobs.size() > MaxJobs)
+    {
+      m_jobs.erase(m_jobs.begin());
+    }
+  }
+
+  // Heavy operations are serialized on the worker so that the io threads
+  // keep serving parameter traffic while e.g. a chain is being rebuilt
+  boost::asio::post(m_worker, [this, id, work = std::move(work)] {
+      setJobStatus(id, JobStatus::Running);
+      try
+      {
+        work();
+        setJobStatus(id, JobStatus::Done);
+      }
+      catch (const std::exception& e)
+      {
+        printf("Error: Job %u failed: %s\n", id, e.what());
+        setJobStatus(id, JobStatus::Failed, e.what());
+      }
+      });
+
+  return id;
+}
+
+const char* ConfigurationBackendImpl::toString(JobStatus status)
+{
+  switch (status)
+  {
+    case JobStatus::Pending:
+      return "pending";
+    case JobStatus::Running:
+      return "running";
+    case JobStatus::Done:
+      return "done";
+    case JobStatus::Failed:
+    default:
+      return "failed";
+  }
+}
+
+void ConfigurationBackendImpl::setJobStatus(std::uint32_t id, JobStatus status, const std::string& error)
+{
+  std::lock_guard<std::mutex> lock(m_jobsMutex);
+  auto it = m_jobs.find(id);
+  if (it != m_jobs.end())
+  {
+    it->second = {status, error};
+  }
+}
+
+void ConfigurationBackendImpl::registerOnGetLevels(const OnGetLevelsCallback& callback)
+{
+  m_getLevels = callback;
+}
+
+void ConfigurationBackendImpl::registerOnStartTrace(const OnStartTraceCallback& callback)
+{
+  m_startTrace = callback;
+}
+
+void ConfigurationBackendImpl::registerOnStopTrace(const OnStopTraceCallback& callback)
+{
+  m_stopTrace = callback;
+}
+
 void ConfigurationBackendImpl::start(std::uint32_t port)
 {
   m_router->get(R"(^/plugins$)", [this](beast_http_request r, http_context c) {
@@ -93,44 +292,55 @@ void ConfigurationBackendImpl::start(std::uint32_t port)
         reply.push_back({{"name", plugin.name}, {"parameters", plugin.parameters}});
       }
 
-      c.send(make_200<beast::http::string_body>(r, reply.dump(), "application/json"));
+      c.send(make_200<beast::http::string_body>(r, reply));
       });
 
   m_router->get(R"(^/config$)", [this](beast_http_request r, http_context c) {
-      json reply;
+      // chainLatency is the latency from the capture ports to the output of
+      // the slot, so that of the last slot is the total
+      json reply = json::array();
+      std::uint32_t chainLatency = 0;
       for (auto& plugin : m_getConfig())
       {
-        reply.push_back({{"name", plugin.name}, {"parameters", plugin.parameters}});
+        chainLatency += plugin.latency;
+        reply.push_back({
+            {"name", plugin.name},
+            {"parameters", plugin.parameters},
+            {"channels", plugin.channels},
+            {"latency", plugin.latency},
+            {"chainLatency", chainLatency}});
       }
 
-      c.send(make_200<beast::http::string_body>(r, reply.dump(), "application/json"));
+      c.send(make_200<beast::http::string_body>(r, reply));
       });
 
   m_router->options(R"(^/.+$)", [this](beast_http_request r, http_context c) {
       beast::http::response<beast::http::string_body> response{beast::http::status::ok, r.version()};
       response.set(beast::http::field::server, BOOST_BEAST_VERSION_STRING);
       response.set(beast::http::field::access_control_allow_origin, "*");
-      response.set(beast::http::field::access_control_allow_methods, "GET, POST, PUT");
-      response.set(beast::http::field::access_control_allow_headers, "Content-Type");
+      response.set(beast::http::field::access_control_allow_methods, "GET, POST, PUT, PATCH");
+      response.set(beast::http::field::access_control_allow_headers, "Content-Type, Accept");
       response.prepare_payload();
       response.keep_alive(r.keep_alive());
       c.send(response);
       });
 
   m_router->put(R"(^/config$)", [this](beast_http_request r, http_context c) {
-      auto json = json::parse(r.body());
+      auto json = parse_body(r);
       FxChainConfiguration config;
       std::transform(
           json.begin(),
           json.end(),
           std::back_inserter(config),
           [](auto& fx) {
-            return FxConfiguration {fx["name"], fx["parameters"]};
+            return FxConfiguration {fx["name"], fx["parameters"], fx.value("channels", 2U)};
           });
 
-      m_applyConfig(config);
+      auto job = submitJob([this, config] {
+          m_applyConfig(config);
+          });
 
-      c.send(make_200<beast::http::string_body>(r, json.dump(), "application/json"));
+      c.send(make_202<beast::http::string_body>(r, job));
       });
 
   m_router->param<pack>().get(R"(^/config/([0-9]+)$)", [this](beast_http_request r, http_context c, auto args) {
@@ -139,20 +349,118 @@ void ConfigurationBackendImpl::start(std::uint32_t port)
       json reply;
       reply = m_getConfig()[index].parameters;
 
-      c.send(make_200<beast::http::string_body>(r, reply.dump(), "application/json"));
+      c.send(make_200<beast::http::string_body>(r, reply));
       });
 
   m_router->param<pack>().put(R"(^/config/([0-9]+)$)", [this](beast_http_request r, http_context c, auto args) {
       auto index = std::get<0>(args);
-      auto json = json::parse(r.body());
+      auto json = parse_body(r);
 
       m_setParameters(index, json);
-      c.send(make_200<beast::http::string_body>(r, json.dump(), "application/json"));
+      c.send(make_200<beast::http::string_body>(r, json));
+      });
+
+  // Accepts [{"slot": s, "index": i, "value": v}, ...] or [[s, i, v], ...]
+  // and applies all updates in the same audio cycle
+  m_router->all(R"(^/config/params$)", [this](beast_http_request r, http_context c) {
+      if (r.method() != beast::http::verb::patch)
+      {
+        c.send(make_404<beast::http::string_body>(r, "not found", "text/html"));
+        return;
+      }
+
+      try
+      {
+        auto json = parse_body(r);
+        ParameterUpdates updates;
+        std::transform(
+            json.begin(),
+            json.end(),
+            std::back_inserter(updates),
+            [](auto& update) {
+              if (update.is_array())
+              {
+                return ParameterUpdate {update.at(0), update.at(1), update.at(2)};
+              }
+              return ParameterUpdate {update.at("slot"), update.at("index"), update.at("value")};
+            });
+
+        m_setParameterBatch(updates);
+        c.send(make_200<beast::http::string_body>(r, json));
+      }
+      catch (const std::exception& e)
+      {
+        c.send(make_400<beast::http::string_body>(r, e.what(), "text/plain"));
+      }
       });
 
   m_router->post(R"(^/reload$)", [this](beast_http_request r, http_context c) {
-      m_reload();
-      c.send(make_200<beast::http::string_body>(r, "{}", "application/json"));
+      auto job = submitJob([this] {
+          m_reload();
+          });
+
+      c.send(make_202<beast::http::string_body>(r, job));
+      });
+
+  m_router->param<pack>().get(R"(^/jobs/([0-9]+)$)", [this](beast_http_request r, http_context c, auto args) {
+      std::uint32_t id = std::get<0>(args);
+
+      Job job;
+      {
+        std::lock_guard<std::mutex> lock(m_jobsMutex);
+        auto it = m_jobs.find(id);
+        if (it == m_jobs.end())
+        {
+          c.send(make_404<beast::http::string_body>(r, "not found", "text/html"));
+          return;
+        }
+        job = it->second;
+      }
+
+      json reply{{"job", id}, {"status", toString(job.status)}};
+      if (job.status == JobStatus::Failed)
+      {
+        reply["error"] = job.error;
+      }
+
+      c.send(make_200<beast::http::string_body>(r, reply));
+      });
+
+  m_router->post(R"(^/trace/start$)", [this](beast_http_request r, http_context c) {
+      m_startTrace();
+      c.send(make_200<beast::http::string_body>(r, json{{"tracing", true}}));
+      });
+
+  // Replies with a Chrome trace, load it in chrome://tracing or Perfetto
+  m_router->post(R"(^/trace/stop$)", [this](beast_http_request r, http_context c) {
+      auto trace = m_stopTrace();
+
+      json events = json::array();
+      for (auto track = 0U; track < trace.tracks.size(); ++track)
+      {
+        events.push_back({
+            {"name", "thread_name"},
+            {"ph", "M"},
+            {"pid", 1},
+            {"tid", track},
+            {"args", {{"name", trace.tracks[track]}}}});
+      }
+
+      for (auto& record : trace.records)
+      {
+        events.push_back({
+            {"name", record.name},
+            {"ph", std::string(1, record.phase)},
+            {"ts", record.timestamp},
+            {"pid", 1},
+            {"tid", record.track}});
+      }
+
+      json reply{{"traceEvents", std::move(events)}, {"displayTimeUnit", "ms"}};
+
+      auto response = make_200<beast::http::string_body>(r, reply.dump(), "application/json");
+      response.set(beast::http::field::content_disposition, "attachment; filename=\"awesome-fxd-trace.json\"");
+      c.send(response);
       });
 
   m_router->get(R"(^/globalsettings$)", [this](beast_http_request r, http_context c) {
@@ -161,15 +469,19 @@ void ConfigurationBackendImpl::start(std::uint32_t port)
       auto settings = m_getGlobalSettings();
       reply["mono-input"] = settings.monoInput;
 
-      c.send(make_200<beast::http::string_body>(r, reply.dump(), "application/json"));
+      c.send(make_200<beast::http::string_body>(r, reply));
       });
 
  m_router->put(R"(^/globalsettings$)", [this](beast_http_request r, http_context c) {
-      auto json = json::parse(r.body());
+      auto json = parse_body(r);
 
-      m_applyGlobalSettings({json["mono-input"]});
+      GlobalSettings settings{json["mono-input"]};
 
-      c.send(make_200<beast::http::string_body>(r, json.dump(), "application/json"));
+      auto job = submitJob([this, settings] {
+          m_applyGlobalSettings(settings);
+          });
+
+      c.send(make_202<beast::http::string_body>(r, job));
       });
 
   m_router->all(R"(^.*$)", [](beast_http_request r, http_context c) {
@@ -193,4 +505,19 @@ void ConfigurationBackendImpl::start(std::uint32_t port)
 
     printf("Starting configuration backend on %s:%u\n", address.to_string().c_str(), port);
     http_listener::launch(m_io, {address, static_cast<uint16_t>(port)}, onAccept, onError);
+
+    // {"levels": [{"peak": [l, r], "rms": [l, r]}, ...]}, one entry per slot
+    auto meterFrame = [this] {
+      json frame{{"levels", json::array()}};
+      for (auto& slot : m_getLevels())
+      {
+        frame["levels"].push_back({
+            {"peak", {slot.peakLeft, slot.peakRight}},
+            {"rms", {slot.rmsLeft, slot.rmsRight}}});
+      }
+      return frame.dump();
+    };
+
+    m_meterStream = std::make_unique<MeterStream>(m_io, meterFrame);
+    m_meterStream->start(port + 1, MeterFramesPerSecond);
 }
@@ -2,6 +2,7 @@
 #define CONFIGURATION_BACKEND_IMPL_H
 
 #include <configuration_backend.h>
+#include "meter_stream.h"
 #include <boost/asio/io_context.hpp>
 #include <http/reactor/listener.hxx>
 #include <http/reactor/session.hxx>
@@ -9,6 +10,9 @@
 #include <http/out.hxx>
 #include <boost/asio/posix/stream_descriptor.hpp>
 #include <boost/asio/signal_set.hpp>
+#include <map>
+#include <mutex>
+#include <string>
 
 using namespace _0xdead4ead;
 namespace beast = boost::beast;
@@ -28,26 +32,58 @@ namespace awesomefx
 class ConfigurationBackendImpl : public ConfigurationBackend
 {
   public:
-    ConfigurationBackendImpl(boost::asio::io_context& io);
+    ConfigurationBackendImpl(boost::asio::io_context& io, boost::asio::io_context& worker);
     ~ConfigurationBackendImpl() = default;
     void registerOnGetPlugins(const OnGetPluginsCallback& callback) override;
     void registerOnApplyConfig(const OnApplyConfigCallback& callback) override;
     void registerOnGetConfig(const OnGetConfigCallback& callback) override;
     void registerOnSetParameters(const OnSetParametersCallback& callback) override;
+    void registerOnSetParameterBatch(const OnSetParameterBatchCallback& callback) override;
     void registerOnReload(const OnReloadCallback& callback) override;
     void registerOnApplyGlobalSettings(const OnApplyGlobalSettingsCallback& callback) override;
     void registerOnGetGlobalSettings(const OnGetGlobalSettingsCallback& callback) override;
+    void registerOnGetLevels(const OnGetLevelsCallback& callback) override;
+    void registerOnStartTrace(const OnStartTraceCallback& callback) override;
+    void registerOnStopTrace(const OnStopTraceCallback& callback) override;
+    // Also streams meter levels over WebSocket on port + 1
     void start(std::uint32_t port) override;
 
   private:
+    enum class JobStatus
+    {
+      Pending,
+      Running,
+      Done,
+      Failed
+    };
+
+    struct Job
+    {
+      JobStatus status;
+      std::string error;
+    };
+
+    static const char* toString(JobStatus status);
+    std::uint32_t submitJob(std::function<void()> work);
+    void setJobStatus(std::uint32_t id, JobStatus status, const std::string& error = "");
+
     OnGetPluginsCallback m_getPlugins;
     OnApplyConfigCallback m_applyConfig;
     OnGetConfigCallback m_getConfig;
     OnSetParametersCallback m_setParameters;
+    OnSetParameterBatchCallback m_setParameterBatch;
     OnReloadCallback m_reload;
     OnApplyGlobalSettingsCallback m_applyGlobalSettings;
     OnGetGlobalSettingsCallback m_getGlobalSettings;
+    OnGetLevelsCallback m_getLevels;
+    OnStartTraceCallback m_startTrace;
+    OnStopTraceCallback m_stopTrace;
     boost::asio::io_context& m_io;
+    boost::asio::io_context& m_worker;
+    std::mutex m_jobsMutex;
+    std::map<std::uint32_t, Job> m_jobs;
+    std::uint32_t m_nextJobId = 1;
+    std::unique_ptr<MeterStream> m_meterStream;
     std::unique_ptr<http::basic_router<http_session>> m_router =
       std::make_unique<http::basic_router<http_session>>(std::regex::ECMAScript);
 };
@@ -0,0 +1,186 @@
+#include "meter_stream.h"
+#include <boost/beast/core.hpp>
+#include <boost/beast/websocket.hpp>
+#include <boost/asio/post.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <deque>
+
+using namespace awesomefx;
+
+namespace beast = boost::beast;
+namespace websocket = boost::beast::websocket;
+using tcp = boost::asio::ip::tcp;
+
+namespace
+{
+
+// Frames queued per subscriber before new ones are dropped
+const std::size_t MaxQueuedFrames = 4;
+
+}
+
+class MeterStream::Session : public std::enable_shared_from_this<MeterStream::Session>
+{
+  public:
+    Session(tcp::socket socket)
+      : m_ws(std::move(socket))
+    {
+    }
+
+    void start()
+    {
+      m_ws.async_accept(beast::bind_front_handler(&Session::onAccept, shared_from_this()));
+    }
+
+    void send(std::shared_ptr<const std::string> frame)
+    {
+      boost::asio::post(m_ws.get_executor(), [self = shared_from_this(), frame = std::move(frame)] {
+          if (!self->m_open || self->m_queue.size() >= MaxQueuedFrames)
+          {
+            return;
+          }
+
+          self->m_queue.push_back(std::move(frame));
+          if (self->m_queue.size() == 1)
+          {
+            self->write();
+          }
+          });
+    }
+
+  private:
+    void onAccept(beast::error_code ec)
+    {
+      if (ec)
+      {
+        return;
+      }
+
+      m_open = true;
+      read();
+    }
+
+    // Keeps a read pending to handle control frames and notice the close
+    void read()
+    {
+      m_ws.async_read(m_buffer, beast::bind_front_handler(&Session::onRead, shared_from_this()));
+    }
+
+    void onRead(beast::error_code ec, std::size_t)
+    {
+      if (ec)
+      {
+        m_open = false;
+        return;
+      }
+
+      m_buffer.consume(m_buffer.size());
+      read();
+    }
+
+    void write()
+    {
+      m_ws.text(true);
+      m_ws.async_write(
+          boost::asio::buffer(*m_queue.front()),
+          beast::bind_front_handler(&Session::onWrite, shared_from_this()));
+    }
+
+    void onWrite(beast::error_code ec, std::size_t)
+    {
+      if (ec)
+      {
+        m_open = false;
+        m_queue.clear();
+        return;
+      }
+
+      m_queue.pop_front();
+      if (!m_queue.empty())
+      {
+        write();
+      }
+    }
+
+    websocket::stream<beast::tcp_stream> m_ws;
+    beast::flat_buffer m_buffer;
+    std::deque<std::shared_ptr<const std::string>> m_queue;
+    bool m_open = false;
+};
+
+MeterStream::MeterStream(boost::asio::io_context& io, FrameSource source)
+  : m_io(io)
+  , m_source(std::move(source))
+  , m_acceptor(boost::asio::make_strand(io))
+  , m_timer(boost::asio::make_strand(io))
+{
+}
+
+void MeterStream::start(std::uint32_t port, std::uint32_t framesPerSecond)
+{
+  tcp::endpoint endpoint{boost::asio::ip::address_v4::any(), static_cast<std::uint16_t>(port)};
+
+  m_acceptor.open(endpoint.protocol());
+  m_acceptor.set_option(boost::asio::socket_base::reuse_address(true));
+  m_acceptor.bind(endpoint);
+  m_acceptor.listen();
+
+  m_period = std::chrono::milliseconds(1000 / std::max(1U, framesPerSecond));
+
+  printf("Starting meter stream on ws://%s:%u\n", endpoint.address().to_string().c_str(), port);
+  accept();
+  tick();
+}
+
+void MeterStream::accept()
+{
+  m_acceptor.async_accept(boost::asio::make_strand(m_io), [this](beast::error_code ec, tcp::socket socket) {
+      if (!ec)
+      {
+        auto session = std::make_shared<Session>(std::move(socket));
+        session->start();
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_sessions.push_back(session);
+      }
+      accept();
+      });
+}
+
+void MeterStream::tick()
+{
+  m_timer.expires_after(m_period);
+  m_timer.async_wait([this](beast::error_code ec) {
+      if (ec)
+      {
+        return;
+      }
+
+      std::vector<std::shared_ptr<Session>> sessions;
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_sessions.erase(
+            std::remove_if(m_sessions.begin(), m_sessions.end(), [](auto& s) { return s.expired(); }),
+            m_sessions.end());
+
+        for (auto& session : m_sessions)
+        {
+          if (auto s = session.lock())
+          {
+            sessions.push_back(std::move(s));
+          }
+        }
+      }
+
+      // The meters are read even when nobody is listening, or a new listener
+      // would first get the peaks queued up since the last one left
+      auto frame = std::make_shared<const std::string>(m_source());
+      for (auto& session : sessions)
+      {
+        session->send(frame);
+      }
+
+      tick();
+      });
+}
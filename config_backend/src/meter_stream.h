@@ -0,0 +1,50 @@
+#ifndef METER_STREAM_H
+#define METER_STREAM_H
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/strand.hpp>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace awesomefx
+{
+
+// Streams meter frames to WebSocket subscribers. Each frame is encoded once
+// by the frame source and shared by every subscriber, slow subscribers
+// drop frames instead of queueing them up.
+class MeterStream
+{
+  public:
+    using FrameSource = std::function<std::string()>;
+
+    MeterStream(boost::asio::io_context& io, FrameSource source);
+    MeterStream() = delete;
+    MeterStream(const MeterStream&) = delete;
+    ~MeterStream() = default;
+
+    void start(std::uint32_t port, std::uint32_t framesPerSecond);
+
+  private:
+    class Session;
+
+    void accept();
+    void tick();
+
+    boost::asio::io_context& m_io;
+    FrameSource m_source;
+    boost::asio::ip::tcp::acceptor m_acceptor;
+    boost::asio::steady_timer m_timer;
+    std::chrono::milliseconds m_period{};
+    std::mutex m_mutex;
+    std::vector<std::weak_ptr<Session>> m_sessions;
+};
+
+}
+
+#endif /* METER_STREAM_H */
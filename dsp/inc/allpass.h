@@ -0,0 +1,86 @@
+#ifndef ALLPASS_H
+#define ALLPASS_H
+
+#include <delay_line.h>
+
+namespace awesomefx
+{
+namespace dsp
+{
+
+// Schroeder allpass. The delayed sample plus the feedforward path forms the
+// output, and the input plus the feedback path is written back. The classic
+// form has feedforward = -feedback.
+template<std::size_t Size, Interpolation Interp = Interpolation::None>
+class Allpass
+{
+  public:
+    Allpass(float gain)
+      : Allpass(gain, -gain)
+    {
+    }
+
+    Allpass(float feedback, float feedforward)
+      : m_feedback(feedback)
+      , m_feedforward(feedforward)
+    {
+    }
+
+    void setGains(float feedback, float feedforward)
+    {
+      m_feedback = feedback;
+      m_feedforward = feedforward;
+    }
+
+    Sample process(Sample in, float delay)
+    {
+      const auto y = m_delay.read(delay) + m_feedforward * in;
+      m_delay.write(in + m_feedback * y);
+      return y;
+    }
+
+    void process(const Sample* in, Sample* out, std::size_t numSamples, float delay)
+    {
+      while (numSamples--)
+      {
+        *out++ = process(*in++, delay);
+      }
+    }
+
+    // Whole sample delay, skips the float to index conversion
+    Sample processFixed(Sample in, std::uint32_t delay)
+    {
+      const auto y = m_delay.tap(delay) + m_feedforward * in;
+      m_delay.write(in + m_feedback * y);
+      return y;
+    }
+
+    void processFixed(Sample* inout, std::size_t numSamples, std::uint32_t delay)
+    {
+      while (numSamples--)
+      {
+        *inout = processFixed(*inout, delay);
+        ++inout;
+      }
+    }
+
+    Sample tap(std::uint32_t delay) const
+    {
+      return m_delay.tap(delay);
+    }
+
+    void clear()
+    {
+      m_delay.clear();
+    }
+
+  private:
+    DelayLine<Size, Interp> m_delay;
+    float m_feedback;
+    float m_feedforward;
+};
+
+}
+}
+
+#endif /* ALLPASS_H */
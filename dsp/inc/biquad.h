@@ -0,0 +1,335 @@
+#ifndef BIQUAD_H
+#define BIQUAD_H
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <audio_processor.h>
+#include <simd.h>
+
+namespace awesomefx
+{
+namespace dsp
+{
+
+// Normalised biquad coefficients, a0 == 1. The designs follow R. Bristow-Johnson's
+// Audio EQ Cookbook. They call std::cos, std::sin and std::pow, so compute
+// them off the RT thread and pass them on.
+struct BiquadCoefficients
+{
+  float b0;
+  float b1;
+  float b2;
+  float a1;
+  float a2;
+
+  static BiquadCoefficients identity()
+  {
+    return {1, 0, 0, 0, 0};
+  }
+
+  static BiquadCoefficients peak(float fs, float freq, float q, float gainDb)
+  {
+    const auto w = Omega(fs, freq);
+    const auto a = std::pow(10.0, gainDb / 40.0);
+    const auto alpha = std::sin(w.omega) / (2 * q);
+    return normalise(1 + alpha * a, -2 * w.cos, 1 - alpha * a, 1 + alpha / a, -2 * w.cos, 1 - alpha / a);
+  }
+
+  static BiquadCoefficients lowShelf(float fs, float freq, float q, float gainDb)
+  {
+    const auto w = Omega(fs, freq);
+    const auto a = std::pow(10.0, gainDb / 40.0);
+    const auto beta = 2 * std::sqrt(a) * std::sin(w.omega) / (2 * q);
+    return normalise(a * ((a + 1) - (a - 1) * w.cos + beta),
+                     2 * a * ((a - 1) - (a + 1) * w.cos),
+                     a * ((a + 1) - (a - 1) * w.cos - beta),
+                     (a + 1) + (a - 1) * w.cos + beta,
+                     -2 * ((a - 1) + (a + 1) * w.cos),
+                     (a + 1) + (a - 1) * w.cos - beta);
+  }
+
+  static BiquadCoefficients highShelf(float fs, float freq, float q, float gainDb)
+  {
+    const auto w = Omega(fs, freq);
+    const auto a = std::pow(10.0, gainDb / 40.0);
+    const auto beta = 2 * std::sqrt(a) * std::sin(w.omega) / (2 * q);
+    return normalise(a * ((a + 1) + (a - 1) * w.cos + beta),
+                     -2 * a * ((a - 1) + (a + 1) * w.cos),
+                     a * ((a + 1) + (a - 1) * w.cos - beta),
+                     (a + 1) - (a - 1) * w.cos + beta,
+                     2 * ((a - 1) - (a + 1) * w.cos),
+                     (a + 1) - (a - 1) * w.cos - beta);
+  }
+
+  static BiquadCoefficients lowpass(float fs, float freq, float q)
+  {
+    const auto w = Omega(fs, freq);
+    const auto alpha = std::sin(w.omega) / (2 * q);
+    return normalise((1 - w.cos) / 2, 1 - w.cos, (1 - w.cos) / 2, 1 + alpha, -2 * w.cos, 1 - alpha);
+  }
+
+  static BiquadCoefficients highpass(float fs, float freq, float q)
+  {
+    const auto w = Omega(fs, freq);
+    const auto alpha = std::sin(w.omega) / (2 * q);
+    return normalise((1 + w.cos) / 2, -(1 + w.cos), (1 + w.cos) / 2, 1 + alpha, -2 * w.cos, 1 - alpha);
+  }
+
+  // Unity gain at the centre frequency
+  static BiquadCoefficients bandpass(float fs, float freq, float q)
+  {
+    const auto w = Omega(fs, freq);
+    const auto alpha = std::sin(w.omega) / (2 * q);
+    return normalise(alpha, 0, -alpha, 1 + alpha, -2 * w.cos, 1 - alpha);
+  }
+
+  private:
+    struct Omega
+    {
+      Omega(float fs, float freq)
+        : omega(2 * M_PI * std::clamp(freq, 1.0f, 0.49f * fs) / fs)
+        , cos(std::cos(omega))
+      {
+      }
+
+      double omega;
+      double cos;
+    };
+
+    static BiquadCoefficients normalise(double b0, double b1, double b2, double a0, double a1, double a2)
+    {
+      BiquadCoefficients coeffs;
+      coeffs.b0 = b0 / a0;
+      coeffs.b1 = b1 / a0;
+      coeffs.b2 = b2 / a0;
+      coeffs.a1 = a1 / a0;
+      coeffs.a2 = a2 / a0;
+      return coeffs;
+    }
+};
+
+// Up to MaxStages biquads in series, in transposed direct form II, for as
+// many channels as Vec has lanes. The channels share the coefficients and run
+// in lockstep, one per lane. New coefficients are reached by a linear ramp so
+// that sweeping a band does not click.
+template<std::size_t MaxStages, typename Vec = Vec4>
+class BiquadCascade
+{
+  public:
+    static constexpr std::size_t Lanes = sizeof(Vec) / sizeof(float);
+
+    BiquadCascade(std::size_t numStages = MaxStages)
+      : m_numStages(std::min(numStages, MaxStages))
+    {
+      for (auto& stage : m_stages)
+      {
+        stage.target = BiquadCoefficients::identity();
+        // Adding to a zero vector broadcasts to every lane
+        stage.b0 = Vec{} + 1.0f;
+      }
+    }
+
+    std::size_t numStages() const
+    {
+      return m_numStages;
+    }
+
+    // Jumps straight to the coefficients
+    void setCoefficients(std::size_t stage, const BiquadCoefficients& coeffs)
+    {
+      auto& s = m_stages[stage];
+      s.target = coeffs;
+      s.remaining = 0;
+      s.b0 = Vec{} + coeffs.b0;
+      s.b1 = Vec{} + coeffs.b1;
+      s.b2 = Vec{} + coeffs.b2;
+      s.a1 = Vec{} + coeffs.a1;
+      s.a2 = Vec{} + coeffs.a2;
+    }
+
+    // Ramps to the coefficients over rampSamples
+    void setTarget(std::size_t stage, const BiquadCoefficients& coeffs, std::uint32_t rampSamples)
+    {
+      if (rampSamples == 0)
+      {
+        setCoefficients(stage, coeffs);
+        return;
+      }
+
+      auto& s = m_stages[stage];
+      const auto scale = Vec{} + 1.0f / rampSamples;
+      s.target = coeffs;
+      s.remaining = rampSamples;
+      s.db0 = ((Vec{} + coeffs.b0) - s.b0) * scale;
+      s.db1 = ((Vec{} + coeffs.b1) - s.b1) * scale;
+      s.db2 = ((Vec{} + coeffs.b2) - s.b2) * scale;
+      s.da1 = ((Vec{} + coeffs.a1) - s.a1) * scale;
+      s.da2 = ((Vec{} + coeffs.a2) - s.a2) * scale;
+    }
+
+    void reset()
+    {
+      for (auto& stage : m_stages)
+      {
+        stage.s1 = Vec{};
+        stage.s2 = Vec{};
+      }
+    }
+
+    // Gives a channel the filter state of another, e.g. one that has been
+    // processing the same signal on its behalf
+    void copyState(std::size_t from, std::size_t to)
+    {
+      for (auto& stage : m_stages)
+      {
+        stage.s1[to] = stage.s1[from];
+        stage.s2[to] = stage.s2[from];
+      }
+    }
+
+    // Channels beyond Lanes are left untouched, RT safe
+    void process(const Sample* const* in, Sample* const* out, std::size_t numChannels, std::size_t numSamples)
+    {
+      numChannels = std::min(numChannels, Lanes);
+
+      while (numSamples)
+      {
+        // Ramp in chunks that end where the first ramp does
+        auto chunk = static_cast<std::uint32_t>(numSamples);
+        for (auto i = 0U; i < m_numStages; ++i)
+        {
+          if (m_stages[i].remaining)
+          {
+            chunk = std::min(chunk, m_stages[i].remaining);
+          }
+        }
+
+        if (isRamping())
+        {
+          run<true>(in, out, numChannels, chunk);
+          finishRamps(chunk);
+        }
+        else
+        {
+          run<false>(in, out, numChannels, chunk);
+        }
+
+        in = advanceInputs(in, numChannels, chunk);
+        out = advanceOutputs(out, numChannels, chunk);
+        numSamples -= chunk;
+      }
+    }
+
+    void process(const Sample* in_l, const Sample* in_r, Sample* out_l, Sample* out_r, std::size_t numSamples)
+    {
+      const Sample* in[] = { in_l, in_r };
+      Sample* out[] = { out_l, out_r };
+      process(in, out, 2, numSamples);
+    }
+
+  private:
+    struct Stage
+    {
+      Vec b0{}, b1{}, b2{}, a1{}, a2{};
+      Vec s1{}, s2{};
+      Vec db0{}, db1{}, db2{}, da1{}, da2{};
+      std::uint32_t remaining = 0;
+      BiquadCoefficients target;
+    };
+
+    bool isRamping() const
+    {
+      for (auto i = 0U; i < m_numStages; ++i)
+      {
+        if (m_stages[i].remaining)
+        {
+          return true;
+        }
+      }
+      return false;
+    }
+
+    template<bool Ramping>
+    void run(const Sample* const* in, Sample* const* out, std::size_t numChannels, std::size_t numSamples)
+    {
+      for (auto i = 0U; i < numSamples; ++i)
+      {
+        Vec x{};
+        for (auto c = 0U; c < numChannels; ++c)
+        {
+          x[c] = in[c][i];
+        }
+
+        for (auto k = 0U; k < m_numStages; ++k)
+        {
+          auto& s = m_stages[k];
+          if (Ramping && s.remaining)
+          {
+            s.b0 += s.db0;
+            s.b1 += s.db1;
+            s.b2 += s.db2;
+            s.a1 += s.da1;
+            s.a2 += s.da2;
+          }
+
+          const auto y = s.b0 * x + s.s1;
+          s.s1 = s.b1 * x - s.a1 * y + s.s2;
+          s.s2 = s.b2 * x - s.a2 * y;
+          x = y;
+        }
+
+        for (auto c = 0U; c < numChannels; ++c)
+        {
+          out[c][i] = x[c];
+        }
+      }
+    }
+
+    void finishRamps(std::uint32_t numSamples)
+    {
+      for (auto i = 0U; i < m_numStages; ++i)
+      {
+        auto& s = m_stages[i];
+        if (s.remaining)
+        {
+          s.remaining -= numSamples;
+          if (!s.remaining)
+          {
+            // Snap to the exact target, the ramp accumulates rounding
+            setCoefficients(i, s.target);
+          }
+        }
+      }
+    }
+
+    const Sample* const* advanceInputs(const Sample* const* in, std::size_t numChannels, std::size_t numSamples)
+    {
+      for (auto c = 0U; c < numChannels; ++c)
+      {
+        m_inputs[c] = in[c] + numSamples;
+      }
+      return m_inputs.data();
+    }
+
+    Sample* const* advanceOutputs(Sample* const* out, std::size_t numChannels, std::size_t numSamples)
+    {
+      for (auto c = 0U; c < numChannels; ++c)
+      {
+        m_outputs[c] = out[c] + numSamples;
+      }
+      return m_outputs.data();
+    }
+
+    std::size_t m_numStages;
+    std::array<Stage, MaxStages> m_stages{};
+    std::array<const Sample*, Lanes> m_inputs{};
+    std::array<Sample*, Lanes> m_outputs{};
+};
+
+}
+}
+
+#endif /* BIQUAD_H */
@@ -0,0 +1,60 @@
+#ifndef COMB_H
+#define COMB_H
+
+#include <delay_line.h>
+
+namespace awesomefx
+{
+namespace dsp
+{
+
+// Feedback comb, y[n] = x[n] + g * y[n - D]
+template<std::size_t Size, Interpolation Interp = Interpolation::None>
+class FeedbackComb
+{
+  public:
+    FeedbackComb(float gain)
+      : m_gain(gain)
+    {
+    }
+
+    void setGain(float gain)
+    {
+      m_gain = gain;
+    }
+
+    Sample process(Sample in, float delay)
+    {
+      const auto y = in + m_gain * m_delay.read(delay);
+      m_delay.write(y);
+      return y;
+    }
+
+    // Adds the comb output to out, which is how comb banks are summed
+    void accumulate(const Sample* in, Sample* out, std::size_t numSamples, float delay, float outputGain)
+    {
+      while (numSamples--)
+      {
+        *out++ += outputGain * process(*in++, delay);
+      }
+    }
+
+    Sample tap(std::uint32_t delay) const
+    {
+      return m_delay.tap(delay);
+    }
+
+    void clear()
+    {
+      m_delay.clear();
+    }
+
+  private:
+    DelayLine<Size, Interp> m_delay;
+    float m_gain;
+};
+
+}
+}
+
+#endif /* COMB_H */
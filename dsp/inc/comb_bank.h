@@ -0,0 +1,88 @@
+#ifndef COMB_BANK_H
+#define COMB_BANK_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <audio_processor.h>
+#include <simd.h>
+
+namespace awesomefx
+{
+namespace dsp
+{
+
+// Eight feedback combs fed by the same input, one per vector lane. Each
+// comb keeps its own line so reads stream through memory per lane, and the
+// delays are whole samples set ahead of time instead of converted per sample.
+template<std::size_t Size>
+class FeedbackCombBank
+{
+  static_assert(Size > 0 && (Size & (Size - 1)) == 0, "Comb bank size must be a power of two");
+
+  public:
+    static constexpr std::size_t Lanes = 8;
+    static constexpr std::uint32_t Mask = Size - 1;
+
+    FeedbackCombBank(const std::array<float, Lanes>& gains)
+    {
+      for (auto i = 0U; i < Lanes; ++i)
+      {
+        m_gains[i] = gains[i];
+      }
+    }
+
+    // Delays in samples, read(1) being the previous output like DelayLine
+    void setDelays(const std::array<std::uint32_t, Lanes>& delays)
+    {
+      for (auto i = 0U; i < Lanes; ++i)
+      {
+        m_delays[i] = delays[i];
+      }
+    }
+
+    // Lane i of out[n] is the output of comb i for in[n]
+    void process(const Sample* in, Vec8* out, std::size_t numSamples)
+    {
+      auto w = m_w;
+      for (auto n = 0U; n < numSamples; ++n)
+      {
+        const auto positions = (static_cast<std::int32_t>(w) - m_delays) & static_cast<std::int32_t>(Mask);
+
+        Vec8 delayed;
+        for (auto i = 0U; i < Lanes; ++i)
+        {
+          delayed[i] = m_buffer[i][positions[i]];
+        }
+
+        const auto y = in[n] + m_gains * delayed;
+        for (auto i = 0U; i < Lanes; ++i)
+        {
+          m_buffer[i][w] = y[i];
+        }
+
+        out[n] = y;
+        w = (w + 1) & Mask;
+      }
+      m_w = w;
+    }
+
+    void clear()
+    {
+      for (auto& line : m_buffer)
+      {
+        line.fill(0);
+      }
+    }
+
+  private:
+    std::array<std::array<Sample, Size>, Lanes> m_buffer{};
+    Vec8 m_gains{};
+    Vec8i m_delays{};
+    std::uint32_t m_w = 0;
+};
+
+}
+}
+
+#endif /* COMB_BANK_H */
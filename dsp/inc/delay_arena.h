@@ -0,0 +1,102 @@
+#ifndef DELAY_ARENA_H
+#define DELAY_ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <audio_processor.h>
+#include <simd.h>
+
+namespace awesomefx
+{
+namespace dsp
+{
+
+// Many delay lines packed into one power of two buffer that share a single
+// write position. Each line owns a contiguous region, and since all regions
+// rotate together, a read or write is one add and one mask against a base
+// offset that can be precomputed together with the delay.
+//
+// Delays count back from the current sample: delay 0 is the slot written
+// this sample, delay 1 the one written on the previous sample.
+class DelayArena
+{
+  public:
+    struct Line
+    {
+      std::uint32_t base;
+      std::uint32_t length;
+
+      // Offset of a delay within this line, valid for delay < length
+      std::uint32_t at(std::uint32_t delay) const
+      {
+        return base + delay;
+      }
+    };
+
+    // Reserves a line for delays up to length - 1. Lines must all be
+    // reserved before allocate().
+    Line reserve(std::uint32_t length)
+    {
+      Line line{m_used, length};
+      m_used += length;
+      return line;
+    }
+
+    // Not RT safe
+    void allocate()
+    {
+      std::size_t size = 1;
+      while (size < m_used)
+      {
+        size <<= 1;
+      }
+
+      m_buffer.assign(size, 0);
+      m_mask = size - 1;
+      m_w = 0;
+    }
+
+    // Moves every line on by one sample
+    void advance()
+    {
+      --m_w;
+    }
+
+    Sample read(std::uint32_t offset) const
+    {
+      return m_buffer[(m_w + offset) & m_mask];
+    }
+
+    void write(std::uint32_t offset, Sample in)
+    {
+      m_buffer[(m_w + offset) & m_mask] = in;
+    }
+
+    // Four lines at once
+    Vec4 read(Vec4u offsets) const
+    {
+      const auto p = (m_w + offsets) & m_mask;
+      return Vec4{m_buffer[p[0]], m_buffer[p[1]], m_buffer[p[2]], m_buffer[p[3]]};
+    }
+
+    void write(Vec4u offsets, Vec4 in)
+    {
+      const auto p = (m_w + offsets) & m_mask;
+      for (auto i = 0U; i < 4; ++i)
+      {
+        m_buffer[p[i]] = in[i];
+      }
+    }
+
+  private:
+    std::vector<Sample> m_buffer;
+    std::uint32_t m_used = 0;
+    std::uint32_t m_mask = 0;
+    std::uint32_t m_w = 0;
+};
+
+}
+}
+
+#endif /* DELAY_ARENA_H */
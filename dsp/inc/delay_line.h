@@ -0,0 +1,134 @@
+#ifndef DELAY_LINE_H
+#define DELAY_LINE_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <audio_processor.h>
+
+namespace awesomefx
+{
+namespace dsp
+{
+
+enum class Interpolation
+{
+  None,
+  Linear,
+  Cubic,
+  Allpass
+};
+
+// Circular delay line with a power of two size so wrapping is a mask.
+//
+// Delays are counted from the next write position: read(1) returns the most
+// recently written sample, read(Size) the oldest one. Fractional delays are
+// resolved by the selected interpolation; None rounds the delay up to the
+// next whole sample. Linear needs a delay of at least 1, Cubic of at least 2.
+// Allpass interpolation keeps state, so it needs one read per write with a
+// slowly varying delay.
+template<std::size_t Size, Interpolation Interp = Interpolation::None>
+class DelayLine
+{
+  static_assert(Size > 0 && (Size & (Size - 1)) == 0, "Delay line size must be a power of two");
+
+  public:
+    static constexpr std::size_t Mask = Size - 1;
+
+    static constexpr std::size_t size()
+    {
+      return Size;
+    }
+
+    void write(Sample in)
+    {
+      m_buffer[m_w] = in;
+      m_w = (m_w + 1) & Mask;
+    }
+
+    void write(const Sample* in, std::size_t numSamples)
+    {
+      while (numSamples--)
+      {
+        write(*in++);
+      }
+    }
+
+    Sample tap(std::uint32_t delay) const
+    {
+      return m_buffer[(m_w - delay) & Mask];
+    }
+
+    Sample read(float delay)
+    {
+      // Offsetting by Size keeps the position positive for 0 <= delay <= Size,
+      // so truncation is a floor
+      const auto position = static_cast<float>(m_w + Size) - delay;
+      const auto i = static_cast<std::uint32_t>(position);
+
+      if constexpr (Interp == Interpolation::None)
+      {
+        return m_buffer[i & Mask];
+      }
+      else if constexpr (Interp == Interpolation::Linear)
+      {
+        const auto f = position - i;
+        const auto x0 = m_buffer[i & Mask];
+        const auto x1 = m_buffer[(i + 1) & Mask];
+        return x0 + (x1 - x0) * f;
+      }
+      else if constexpr (Interp == Interpolation::Cubic)
+      {
+        // 4-point, 3rd order Hermite
+        const auto f = position - i;
+        const auto xm1 = m_buffer[(i - 1) & Mask];
+        const auto x0 = m_buffer[i & Mask];
+        const auto x1 = m_buffer[(i + 1) & Mask];
+        const auto x2 = m_buffer[(i + 2) & Mask];
+        const auto c1 = 0.5f * (x1 - xm1);
+        const auto c2 = xm1 - 2.5f * x0 + 2.0f * x1 - 0.5f * x2;
+        const auto c3 = 0.5f * (x2 - xm1) + 1.5f * (x0 - x1);
+        return ((c3 * f + c2) * f + c1) * f + x0;
+      }
+      else
+      {
+        // First order allpass between the two nearest samples
+        const auto f = position - i;
+        const auto eta = f / (2.0f - f);
+        m_allpassState = eta * m_buffer[(i + 1) & Mask] + m_buffer[i & Mask] - eta * m_allpassState;
+        return m_allpassState;
+      }
+    }
+
+    // Reads the delayed sample and then writes the input
+    Sample process(Sample in, float delay)
+    {
+      const auto out = read(delay);
+      write(in);
+      return out;
+    }
+
+    void process(const Sample* in, Sample* out, std::size_t numSamples, float delay)
+    {
+      while (numSamples--)
+      {
+        *out++ = process(*in++, delay);
+      }
+    }
+
+    void clear()
+    {
+      m_buffer.fill(0);
+      m_allpassState = 0;
+    }
+
+  private:
+    std::array<Sample, Size> m_buffer{};
+    std::uint32_t m_w = 0;
+    Sample m_allpassState = 0;
+};
+
+}
+}
+
+#endif /* DELAY_LINE_H */
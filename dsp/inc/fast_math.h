@@ -0,0 +1,85 @@
+#ifndef FAST_MATH_H
+#define FAST_MATH_H
+
+#include <cstdint>
+#include <simd.h>
+
+namespace awesomefx
+{
+namespace dsp
+{
+
+namespace detail
+{
+
+// Odd Taylor polynomial of sin(2 pi x) to degree 11, within 2e-7 of the
+// float result for |x| <= 0.25
+template<typename T>
+inline T sinQuadrant(T x)
+{
+  const auto x2 = x * x;
+  auto p = T{} + -15.094642576822984f;
+  p = p * x2 + 42.058693944897634f;
+  p = p * x2 + -76.70585975306136f;
+  p = p * x2 + 81.60524927607504f;
+  p = p * x2 + -41.341702240399755f;
+  p = p * x2 + 6.283185307179586f;
+  return p * x;
+}
+
+}
+
+// sin(2 pi x) for a phase x in turns. Valid for |x| < 2^31.
+inline float sinTurns(float x)
+{
+  // Reduce to [-0.5, 0.5] and fold the outer quadrants onto the inner ones
+  x -= static_cast<float>(static_cast<std::int32_t>(x));
+  if (x > 0.5f) x -= 1.0f;
+  if (x < -0.5f) x += 1.0f;
+  if (x > 0.25f) x = 0.5f - x;
+  if (x < -0.25f) x = -0.5f - x;
+  return detail::sinQuadrant(x);
+}
+
+inline float cosTurns(float x)
+{
+  return sinTurns(x + 0.25f);
+}
+
+inline Vec4 sinTurns(Vec4 x)
+{
+  const auto half = broadcast(0.5f);
+  const auto quarter = broadcast(0.25f);
+
+  x -= __builtin_convertvector(__builtin_convertvector(x, Vec4i), Vec4);
+  x = x > half ? x - 1.0f : x;
+  x = x < -half ? x + 1.0f : x;
+  x = x > quarter ? half - x : x;
+  x = x < -quarter ? -half - x : x;
+  return detail::sinQuadrant(x);
+}
+
+inline Vec4 cosTurns(Vec4 x)
+{
+  return sinTurns(x + 0.25f);
+}
+
+// Fills out with sin(2 pi x) of each phase
+inline void sinTurns(const float* phases, float* out, std::size_t numSamples)
+{
+  auto i = 0U;
+  for (; i + 4 <= numSamples; i += 4)
+  {
+    store(out + i, sinTurns(load(phases + i)));
+  }
+
+  for (; i < numSamples; ++i)
+  {
+    out[i] = sinTurns(phases[i]);
+  }
+}
+
+}
+}
+
+#endif /* FAST_MATH_H */
@@ -0,0 +1,442 @@
+#ifndef FFT_H
+#define FFT_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include <simd.h>
+
+namespace awesomefx
+{
+namespace dsp
+{
+
+namespace detail
+{
+
+template<typename T>
+inline void complexMultiply(T& re, T& im, T wr, T wi)
+{
+  const auto r = re * wr - im * wi;
+  im = re * wi + im * wr;
+  re = r;
+}
+
+// One radix 4 decimation in frequency butterfly, outputs in place of the inputs
+template<typename T>
+inline void butterfly4(T& ar, T& ai, T& br, T& bi, T& cr, T& ci, T& dr, T& di,
+                       T w1r, T w1i, T w2r, T w2i, T w3r, T w3i)
+{
+  const auto apcr = ar + cr, apci = ai + ci;
+  const auto amcr = ar - cr, amci = ai - ci;
+  const auto bpdr = br + dr, bpdi = bi + di;
+  const auto bmdr = br - dr, bmdi = bi - di;
+
+  ar = apcr + bpdr;
+  ai = apci + bpdi;
+  br = amcr + bmdi;
+  bi = amci - bmdr;
+  cr = apcr - bpdr;
+  ci = apci - bpdi;
+  dr = amcr - bmdi;
+  di = amci + bmdr;
+
+  complexMultiply(br, bi, w1r, w1i);
+  complexMultiply(cr, ci, w2r, w2i);
+  complexMultiply(dr, di, w3r, w3i);
+}
+
+inline void transpose(Vec4& r0, Vec4& r1, Vec4& r2, Vec4& r3)
+{
+  const auto t0 = __builtin_shuffle(r0, r1, Vec4i{0, 4, 1, 5});
+  const auto t1 = __builtin_shuffle(r0, r1, Vec4i{2, 6, 3, 7});
+  const auto t2 = __builtin_shuffle(r2, r3, Vec4i{0, 4, 1, 5});
+  const auto t3 = __builtin_shuffle(r2, r3, Vec4i{2, 6, 3, 7});
+  r0 = __builtin_shuffle(t0, t2, Vec4i{0, 1, 4, 5});
+  r1 = __builtin_shuffle(t0, t2, Vec4i{2, 3, 6, 7});
+  r2 = __builtin_shuffle(t1, t3, Vec4i{0, 1, 4, 5});
+  r3 = __builtin_shuffle(t1, t3, Vec4i{2, 3, 6, 7});
+}
+
+inline Vec4 reverse(Vec4 v)
+{
+  return __builtin_shuffle(v, Vec4i{3, 2, 1, 0});
+}
+
+}
+
+// Complex FFT of a power of two size on split real and imaginary arrays.
+// Stockham autosort radix 4 stages, with one radix 2 stage when the size is
+// an odd power of two, so no bit reversal pass is needed. The plan and
+// scratch buffers are built up front; transforms never allocate.
+class ComplexFft
+{
+  public:
+    ComplexFft(std::size_t size)
+      : m_size(size)
+      , m_scratchRe(size)
+      , m_scratchIm(size)
+    {
+      auto n = size;
+      auto s = std::size_t{1};
+      while (n >= 4)
+      {
+        m_stages.push_back({n, s, m_w1r.size()});
+        for (auto p = 0U; p < n / 4; ++p)
+        {
+          const auto theta = -2 * M_PI * p / n;
+          m_w1r.push_back(std::cos(theta));
+          m_w1i.push_back(std::sin(theta));
+          m_w2r.push_back(std::cos(2 * theta));
+          m_w2i.push_back(std::sin(2 * theta));
+          m_w3r.push_back(std::cos(3 * theta));
+          m_w3i.push_back(std::sin(3 * theta));
+        }
+        n /= 4;
+        s *= 4;
+      }
+      m_radix2Stride = n == 2 ? s : 0;
+    }
+
+    std::size_t size() const
+    {
+      return m_size;
+    }
+
+    // In place and unscaled
+    void forward(float* re, float* im)
+    {
+      auto* xr = re;
+      auto* xi = im;
+      auto* yr = m_scratchRe.data();
+      auto* yi = m_scratchIm.data();
+
+      for (const auto& stage : m_stages)
+      {
+        radix4(stage, xr, xi, yr, yi);
+        std::swap(xr, yr);
+        std::swap(xi, yi);
+      }
+
+      if (m_radix2Stride)
+      {
+        radix2(m_radix2Stride, xr, xi, yr, yi);
+        std::swap(xr, yr);
+        std::swap(xi, yi);
+      }
+
+      if (xr != re)
+      {
+        std::copy_n(xr, m_size, re);
+        std::copy_n(xi, m_size, im);
+      }
+    }
+
+    // In place and unscaled, so a round trip multiplies by the size
+    void inverse(float* re, float* im)
+    {
+      forward(im, re);
+    }
+
+  private:
+    struct Stage
+    {
+      std::size_t n;
+      std::size_t s;
+      std::size_t twiddles;
+    };
+
+    void radix4(const Stage& stage, const float* xr, const float* xi, float* yr, float* yi) const
+    {
+      const auto n1 = stage.n / 4;
+      const auto s = stage.s;
+      const auto* w1r = &m_w1r[stage.twiddles];
+      const auto* w1i = &m_w1i[stage.twiddles];
+      const auto* w2r = &m_w2r[stage.twiddles];
+      const auto* w2i = &m_w2i[stage.twiddles];
+      const auto* w3r = &m_w3r[stage.twiddles];
+      const auto* w3i = &m_w3i[stage.twiddles];
+
+      if (s >= 4)
+      {
+        // Lanes run along the stride, sharing one twiddle
+        for (auto p = 0U; p < n1; ++p)
+        {
+          const auto v1r = broadcast(w1r[p]), v1i = broadcast(w1i[p]);
+          const auto v2r = broadcast(w2r[p]), v2i = broadcast(w2i[p]);
+          const auto v3r = broadcast(w3r[p]), v3i = broadcast(w3i[p]);
+
+          for (auto q = 0U; q < s; q += 4)
+          {
+            auto ar = load(xr + q + s * p), ai = load(xi + q + s * p);
+            auto br = load(xr + q + s * (p + n1)), bi = load(xi + q + s * (p + n1));
+            auto cr = load(xr + q + s * (p + 2 * n1)), ci = load(xi + q + s * (p + 2 * n1));
+            auto dr = load(xr + q + s * (p + 3 * n1)), di = load(xi + q + s * (p + 3 * n1));
+
+            detail::butterfly4(ar, ai, br, bi, cr, ci, dr, di, v1r, v1i, v2r, v2i, v3r, v3i);
+
+            store(yr + q + s * 4 * p, ar);
+            store(yi + q + s * 4 * p, ai);
+            store(yr + q + s * (4 * p + 1), br);
+            store(yi + q + s * (4 * p + 1), bi);
+            store(yr + q + s * (4 * p + 2), cr);
+            store(yi + q + s * (4 * p + 2), ci);
+            store(yr + q + s * (4 * p + 3), dr);
+            store(yi + q + s * (4 * p + 3), di);
+          }
+        }
+      }
+      else if (n1 >= 4)
+      {
+        // First stage: lanes run along p and a transpose makes the
+        // interleaved outputs contiguous
+        for (auto p = 0U; p < n1; p += 4)
+        {
+          auto ar = load(xr + p), ai = load(xi + p);
+          auto br = load(xr + p + n1), bi = load(xi + p + n1);
+          auto cr = load(xr + p + 2 * n1), ci = load(xi + p + 2 * n1);
+          auto dr = load(xr + p + 3 * n1), di = load(xi + p + 3 * n1);
+
+          detail::butterfly4(ar, ai, br, bi, cr, ci, dr, di,
+                             load(w1r + p), load(w1i + p), load(w2r + p), load(w2i + p), load(w3r + p), load(w3i + p));
+
+          detail::transpose(ar, br, cr, dr);
+          detail::transpose(ai, bi, ci, di);
+
+          store(yr + 4 * p, ar);
+          store(yr + 4 * p + 4, br);
+          store(yr + 4 * p + 8, cr);
+          store(yr + 4 * p + 12, dr);
+          store(yi + 4 * p, ai);
+          store(yi + 4 * p + 4, bi);
+          store(yi + 4 * p + 8, ci);
+          store(yi + 4 * p + 12, di);
+        }
+      }
+      else
+      {
+        for (auto p = 0U; p < n1; ++p)
+        {
+          for (auto q = 0U; q < s; ++q)
+          {
+            auto ar = xr[q + s * p], ai = xi[q + s * p];
+            auto br = xr[q + s * (p + n1)], bi = xi[q + s * (p + n1)];
+            auto cr = xr[q + s * (p + 2 * n1)], ci = xi[q + s * (p + 2 * n1)];
+            auto dr = xr[q + s * (p + 3 * n1)], di = xi[q + s * (p + 3 * n1)];
+
+            detail::butterfly4(ar, ai, br, bi, cr, ci, dr, di, w1r[p], w1i[p], w2r[p], w2i[p], w3r[p], w3i[p]);
+
+            yr[q + s * 4 * p] = ar;
+            yi[q + s * 4 * p] = ai;
+            yr[q + s * (4 * p + 1)] = br;
+            yi[q + s * (4 * p + 1)] = bi;
+            yr[q + s * (4 * p + 2)] = cr;
+            yi[q + s * (4 * p + 2)] = ci;
+            yr[q + s * (4 * p + 3)] = dr;
+            yi[q + s * (4 * p + 3)] = di;
+          }
+        }
+      }
+    }
+
+    static void radix2(std::size_t s, const float* xr, const float* xi, float* yr, float* yi)
+    {
+      auto q = 0U;
+      for (; q + 4 <= s; q += 4)
+      {
+        const auto ar = load(xr + q), ai = load(xi + q);
+        const auto br = load(xr + q + s), bi = load(xi + q + s);
+        store(yr + q, ar + br);
+        store(yi + q, ai + bi);
+        store(yr + q + s, ar - br);
+        store(yi + q + s, ai - bi);
+      }
+
+      for (; q < s; ++q)
+      {
+        const auto ar = xr[q], ai = xi[q];
+        const auto br = xr[q + s], bi = xi[q + s];
+        yr[q] = ar + br;
+        yi[q] = ai + bi;
+        yr[q + s] = ar - br;
+        yi[q + s] = ai - bi;
+      }
+    }
+
+    std::size_t m_size;
+    std::size_t m_radix2Stride;
+    std::vector<Stage> m_stages;
+    AlignedVector<float> m_w1r;
+    AlignedVector<float> m_w1i;
+    AlignedVector<float> m_w2r;
+    AlignedVector<float> m_w2i;
+    AlignedVector<float> m_w3r;
+    AlignedVector<float> m_w3i;
+    AlignedVector<float> m_scratchRe;
+    AlignedVector<float> m_scratchIm;
+};
+
+// FFT of a real signal of a power of two size, at least 2, through a
+// complex FFT of half the size. Spectra are split arrays of size / 2 + 1
+// bins from DC to Nyquist.
+class RealFft
+{
+  public:
+    RealFft(std::size_t size)
+      : m_size(size)
+      , m_half(size / 2)
+      , m_fft(size / 2)
+      , m_zr(size / 2)
+      , m_zi(size / 2)
+      , m_wr(size / 2)
+      , m_wi(size / 2)
+    {
+      for (auto k = 0U; k < m_half; ++k)
+      {
+        m_wr[k] = std::cos(-2 * M_PI * k / size);
+        m_wi[k] = std::sin(-2 * M_PI * k / size);
+      }
+    }
+
+    std::size_t size() const
+    {
+      return m_size;
+    }
+
+    std::size_t bins() const
+    {
+      return m_half + 1;
+    }
+
+    // Unscaled, RT safe
+    void forward(const float* in, float* re, float* im)
+    {
+      auto* zr = m_zr.data();
+      auto* zi = m_zi.data();
+      for (auto k = 0U; k < m_half; ++k)
+      {
+        zr[k] = in[2 * k];
+        zi[k] = in[2 * k + 1];
+      }
+
+      m_fft.forward(zr, zi);
+
+      // Split the packed spectrum into the even and odd sample spectra and
+      // combine them: X[k] = E[k] + W^k O[k]
+      re[0] = zr[0] + zi[0];
+      im[0] = 0;
+      re[m_half] = zr[0] - zi[0];
+      im[m_half] = 0;
+
+      const auto half = broadcast(0.5f);
+      auto k = 1U;
+      for (; k + 4 <= m_half; k += 4)
+      {
+        const auto ar = load(zr + k), ai = load(zi + k);
+        const auto br = detail::reverse(load(zr + m_half - k - 3));
+        const auto bi = -detail::reverse(load(zi + m_half - k - 3));
+        auto er = (ar + br) * half, ei = (ai + bi) * half;
+        auto orr = (ai - bi) * half, oi = (br - ar) * half;
+        detail::complexMultiply(orr, oi, load(&m_wr[k]), load(&m_wi[k]));
+        store(re + k, er + orr);
+        store(im + k, ei + oi);
+      }
+
+      for (; k < m_half; ++k)
+      {
+        const auto ar = zr[k], ai = zi[k];
+        const auto br = zr[m_half - k], bi = -zi[m_half - k];
+        auto er = (ar + br) * 0.5f, ei = (ai + bi) * 0.5f;
+        auto orr = (ai - bi) * 0.5f, oi = (br - ar) * 0.5f;
+        detail::complexMultiply(orr, oi, m_wr[k], m_wi[k]);
+        re[k] = er + orr;
+        im[k] = ei + oi;
+      }
+    }
+
+    // Scaled by 1 / size so that it inverts forward, RT safe
+    void inverse(const float* re, const float* im, float* out)
+    {
+      auto* zr = m_zr.data();
+      auto* zi = m_zi.data();
+
+      // Z[k] = E[k] + i O[k], both doubled; the 2 is folded into the scale
+      {
+        const auto br = re[m_half], bi = -im[m_half];
+        const auto er = re[0] + br, ei = im[0] + bi;
+        const auto orr = re[0] - br, oi = im[0] - bi;
+        zr[0] = er - oi;
+        zi[0] = ei + orr;
+      }
+
+      auto k = 1U;
+
+      for (; k + 4 <= m_half; k += 4)
+      {
+        const auto ar = load(re + k), ai = load(im + k);
+        const auto br = detail::reverse(load(re + m_half - k - 3));
+        const auto bi = -detail::reverse(load(im + m_half - k - 3));
+        const auto er = ar + br, ei = ai + bi;
+        auto orr = ar - br, oi = ai - bi;
+        detail::complexMultiply(orr, oi, load(&m_wr[k]), -load(&m_wi[k]));
+        store(zr + k, er - oi);
+        store(zi + k, ei + orr);
+      }
+
+      for (; k < m_half; ++k)
+      {
+        const auto br = re[m_half - k], bi = -im[m_half - k];
+        const auto er = re[k] + br, ei = im[k] + bi;
+        auto orr = re[k] - br, oi = im[k] - bi;
+        detail::complexMultiply(orr, oi, m_wr[k], -m_wi[k]);
+        zr[k] = er - oi;
+        zi[k] = ei + orr;
+      }
+
+      m_fft.inverse(zr, zi);
+
+      const auto scale = 1.0f / m_size;
+      for (auto n = 0U; n < m_half; ++n)
+      {
+        out[2 * n] = zr[n] * scale;
+        out[2 * n + 1] = zi[n] * scale;
+      }
+    }
+
+  private:
+    std::size_t m_size;
+    std::size_t m_half;
+    ComplexFft m_fft;
+    AlignedVector<float> m_zr;
+    AlignedVector<float> m_zi;
+    AlignedVector<float> m_wr;
+    AlignedVector<float> m_wi;
+};
+
+// acc += x * h over split spectra, the inner loop of FFT convolution
+inline void multiplyAdd(float* accRe, float* accIm, const float* xr, const float* xi,
+                        const float* hr, const float* hi, std::size_t bins)
+{
+  auto k = 0U;
+  for (; k + 4 <= bins; k += 4)
+  {
+    const auto ar = load(xr + k), ai = load(xi + k);
+    const auto br = load(hr + k), bi = load(hi + k);
+    store(accRe + k, load(accRe + k) + ar * br - ai * bi);
+    store(accIm + k, load(accIm + k) + ar * bi + ai * br);
+  }
+
+  for (; k < bins; ++k)
+  {
+    accRe[k] += xr[k] * hr[k] - xi[k] * hi[k];
+    accIm[k] += xr[k] * hi[k] + xi[k] * hr[k];
+  }
+}
+
+}
+}
+
+#endif /* FFT_H */
@@ -0,0 +1,90 @@
+#ifndef ONE_POLE_H
+#define ONE_POLE_H
+
+#include <cmath>
+#include <cstddef>
+#include <audio_processor.h>
+
+namespace awesomefx
+{
+namespace dsp
+{
+
+// One pole lowpass, y[n] = gain * x[n] + feedback * y[n - 1]
+class OnePole
+{
+  public:
+    void setCoefficients(float gain, float feedback)
+    {
+      m_gain = gain;
+      m_feedback = feedback;
+    }
+
+    // Unity gain at DC with the -3 dB point at cutoff
+    void setCutoff(float cutoff, float sampleRate)
+    {
+      const auto feedback = std::exp(-2.0f * 3.14159265f * cutoff / sampleRate);
+      setCoefficients(1.0f - feedback, feedback);
+    }
+
+    Sample process(Sample in)
+    {
+      return m_y1 = m_gain * in + m_feedback * m_y1;
+    }
+
+    void process(const Sample* in, Sample* out, std::size_t numSamples)
+    {
+      auto y1 = m_y1;
+      while (numSamples--)
+      {
+        *out++ = y1 = m_gain * *in++ + m_feedback * y1;
+      }
+      m_y1 = y1;
+    }
+
+    void reset(Sample value = 0)
+    {
+      m_y1 = value;
+    }
+
+  private:
+    Sample m_y1 = 0;
+    float m_gain = 1;
+    float m_feedback = 0;
+};
+
+// Complement of a unity gain OnePole
+class OnePoleHighpass
+{
+  public:
+    void setCutoff(float cutoff, float sampleRate)
+    {
+      m_lowpass.setCutoff(cutoff, sampleRate);
+    }
+
+    Sample process(Sample in)
+    {
+      return in - m_lowpass.process(in);
+    }
+
+    void process(const Sample* in, Sample* out, std::size_t numSamples)
+    {
+      while (numSamples--)
+      {
+        *out++ = process(*in++);
+      }
+    }
+
+    void reset()
+    {
+      m_lowpass.reset();
+    }
+
+  private:
+    OnePole m_lowpass;
+};
+
+}
+}
+
+#endif /* ONE_POLE_H */
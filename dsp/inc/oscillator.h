@@ -0,0 +1,217 @@
+#ifndef OSCILLATOR_H
+#define OSCILLATOR_H
+
+#include <cmath>
+#include <cstddef>
+#include <fast_math.h>
+#include <simd.h>
+
+namespace awesomefx
+{
+namespace dsp
+{
+
+// Phase accumulator in turns, kept in [0, 1) so it never loses precision.
+// Negative increments run backwards.
+class Phasor
+{
+  public:
+    void setFrequency(float frequency, float sampleRate)
+    {
+      setIncrement(frequency / sampleRate);
+    }
+
+    void setIncrement(float increment)
+    {
+      m_increment = increment - static_cast<float>(static_cast<int>(increment));
+    }
+
+    void setPhase(float phase)
+    {
+      m_phase = phase;
+      wrap();
+    }
+
+    float phase() const
+    {
+      return m_phase;
+    }
+
+    float increment() const
+    {
+      return m_increment;
+    }
+
+    // Returns the current phase and advances
+    float next()
+    {
+      const auto phase = m_phase;
+      advance(m_increment);
+      return phase;
+    }
+
+    void advance(float turns)
+    {
+      m_phase += turns;
+      wrap();
+    }
+
+  private:
+    // Steps can exceed a turn, SineOscillator advances four increments at a
+    // time. A tiny negative phase rounds up to 1 after the floor.
+    void wrap()
+    {
+      m_phase -= std::floor(m_phase);
+      if (m_phase >= 1.0f) m_phase = 0.0f;
+    }
+
+    float m_phase = 0;
+    float m_increment = 0;
+};
+
+// Audio rate sine, four samples per polynomial evaluation
+class SineOscillator
+{
+  public:
+    void setFrequency(float frequency, float sampleRate)
+    {
+      m_phasor.setFrequency(frequency, sampleRate);
+    }
+
+    void setPhase(float phase)
+    {
+      m_phasor.setPhase(phase);
+    }
+
+    float next()
+    {
+      return sinTurns(m_phasor.next());
+    }
+
+    void process(float* out, std::size_t numSamples)
+    {
+      const auto increment = m_phasor.increment();
+      const auto lanes = Vec4{0.0f, 1.0f, 2.0f, 3.0f} * increment;
+
+      auto i = 0U;
+      for (; i + 4 <= numSamples; i += 4)
+      {
+        store(out + i, sinTurns(m_phasor.phase() + lanes));
+        m_phasor.advance(4.0f * increment);
+      }
+
+      for (; i < numSamples; ++i)
+      {
+        out[i] = next();
+      }
+    }
+
+  private:
+    Phasor m_phasor;
+};
+
+// Sine and cosine of one phase, for stereo or I/Q modulation
+class QuadratureOscillator
+{
+  public:
+    struct Output
+    {
+      float sin;
+      float cos;
+    };
+
+    void setFrequency(float frequency, float sampleRate)
+    {
+      m_phasor.setFrequency(frequency, sampleRate);
+    }
+
+    Output next()
+    {
+      return next(1);
+    }
+
+    // Returns the current value and advances by numSamples, for evaluating
+    // once per block when blocks vary in length
+    Output next(std::size_t numSamples)
+    {
+      const auto phase = m_phasor.phase();
+      m_phasor.advance(m_phasor.increment() * numSamples);
+      const auto v = sinTurns(Vec4{phase, phase + 0.25f, 0.0f, 0.0f});
+      return {v[0], v[1]};
+    }
+
+  private:
+    Phasor m_phasor;
+};
+
+// Sine LFO evaluated once every Interval samples and linearly ramped in
+// between. Meant for modulation well below the control rate.
+template<std::size_t Interval = 32>
+class ControlRateLfo
+{
+  public:
+    void setFrequency(float frequency, float sampleRate)
+    {
+      m_phasor.setFrequency(frequency * Interval, sampleRate);
+    }
+
+    void setPhase(float phase)
+    {
+      m_phasor.setPhase(phase);
+    }
+
+    float next()
+    {
+      if (m_countdown == 0)
+      {
+        startSegment();
+      }
+
+      --m_countdown;
+      const auto value = m_value;
+      m_value += m_step;
+      return value;
+    }
+
+    void process(float* out, std::size_t numSamples)
+    {
+      while (numSamples)
+      {
+        if (m_countdown == 0)
+        {
+          startSegment();
+        }
+
+        auto n = numSamples < m_countdown ? numSamples : m_countdown;
+        m_countdown -= n;
+        numSamples -= n;
+
+        auto value = m_value;
+        while (n--)
+        {
+          *out++ = value;
+          value += m_step;
+        }
+        m_value = value;
+      }
+    }
+
+  private:
+    void startSegment()
+    {
+      // Restart from the exact value so rounding in the ramp never accumulates
+      m_value = sinTurns(m_phasor.next());
+      m_step = (sinTurns(m_phasor.phase()) - m_value) / Interval;
+      m_countdown = Interval;
+    }
+
+    Phasor m_phasor;
+    float m_value = 0;
+    float m_step = 0;
+    std::size_t m_countdown = 0;
+};
+
+}
+}
+
+#endif /* OSCILLATOR_H */
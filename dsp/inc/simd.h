@@ -0,0 +1,86 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <vector>
+
+namespace awesomefx
+{
+namespace dsp
+{
+
+// Four lane vectors using the GCC/Clang vector extensions, which lower to
+// SSE or NEON without tying the plugins to one instruction set
+using Vec4 = float __attribute__((vector_size(16)));
+using Vec4i = std::int32_t __attribute__((vector_size(16)));
+using Vec4u = std::uint32_t __attribute__((vector_size(16)));
+using Vec8 = float __attribute__((vector_size(32)));
+using Vec8i = std::int32_t __attribute__((vector_size(32)));
+
+inline Vec4 load(const float* p)
+{
+  Vec4 v;
+  std::memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+inline void store(float* p, Vec4 v)
+{
+  std::memcpy(p, &v, sizeof(v));
+}
+
+inline Vec4 broadcast(float x)
+{
+  return Vec4{x, x, x, x};
+}
+
+// Keeps vector buffers on cache line boundaries so no load straddles two lines
+template<typename T, std::size_t Alignment = 64>
+struct AlignedAllocator
+{
+  using value_type = T;
+
+  template<typename U>
+  struct rebind
+  {
+    using other = AlignedAllocator<U, Alignment>;
+  };
+
+  AlignedAllocator() = default;
+
+  template<typename U>
+  AlignedAllocator(const AlignedAllocator<U, Alignment>&) {}
+
+  T* allocate(std::size_t n)
+  {
+    return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(Alignment)));
+  }
+
+  void deallocate(T* p, std::size_t)
+  {
+    ::operator delete(p, std::align_val_t(Alignment));
+  }
+
+  template<typename U>
+  bool operator==(const AlignedAllocator<U, Alignment>&) const
+  {
+    return true;
+  }
+
+  template<typename U>
+  bool operator!=(const AlignedAllocator<U, Alignment>&) const
+  {
+    return false;
+  }
+};
+
+template<typename T>
+using AlignedVector = std::vector<T, AlignedAllocator<T>>;
+
+}
+}
+
+#endif /* SIMD_H */
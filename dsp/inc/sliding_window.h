@@ -0,0 +1,113 @@
+#ifndef SLIDING_WINDOW_H
+#define SLIDING_WINDOW_H
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <audio_processor.h>
+
+namespace awesomefx
+{
+namespace dsp
+{
+
+// Maximum of the last length values, length up to Capacity. Keeps a
+// monotonic deque of the values that can still become the maximum, so each
+// value is pushed and popped once and a sample costs O(1) amortized however
+// long the window is.
+template<std::size_t Capacity>
+class SlidingMax
+{
+  static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+  public:
+    static constexpr std::size_t Mask = Capacity - 1;
+
+    void setLength(std::size_t length)
+    {
+      m_length = std::clamp<std::size_t>(length, 1, Capacity);
+      reset();
+    }
+
+    void reset()
+    {
+      m_head = m_tail = m_time = 0;
+    }
+
+    Sample process(Sample in)
+    {
+      // One value enters per sample, so at most one leaves. It leaves before
+      // the new one enters, which keeps a full window within Capacity.
+      if (m_tail != m_head && m_time - m_times[m_head & Mask] >= m_length)
+      {
+        ++m_head;
+      }
+
+      // Nothing before a larger value can be the maximum again
+      while (m_tail != m_head && m_values[(m_tail - 1) & Mask] <= in)
+      {
+        --m_tail;
+      }
+
+      m_values[m_tail & Mask] = in;
+      m_times[m_tail & Mask] = m_time;
+      ++m_tail;
+      ++m_time;
+
+      return m_values[m_head & Mask];
+    }
+
+  private:
+    std::array<Sample, Capacity> m_values{};
+    std::array<std::uint32_t, Capacity> m_times{};
+    std::uint32_t m_head = 0;
+    std::uint32_t m_tail = 0;
+    std::uint32_t m_time = 0;
+    std::uint32_t m_length = 1;
+};
+
+// Mean of the last length values, length up to Capacity, as a running sum.
+// The sum is kept in double so that it does not drift over hours.
+template<std::size_t Capacity>
+class MovingAverage
+{
+  static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+  public:
+    static constexpr std::size_t Mask = Capacity - 1;
+
+    void setLength(std::size_t length, Sample initial = 0)
+    {
+      m_length = std::clamp<std::size_t>(length, 1, Capacity);
+      m_scale = 1.0 / m_length;
+      reset(initial);
+    }
+
+    // Starts out as if initial had been the input forever
+    void reset(Sample initial = 0)
+    {
+      m_values.fill(initial);
+      m_sum = static_cast<double>(initial) * m_length;
+    }
+
+    Sample process(Sample in)
+    {
+      m_sum += static_cast<double>(in) - m_values[(m_w - m_length) & Mask];
+      m_values[m_w & Mask] = in;
+      ++m_w;
+      return m_sum * m_scale;
+    }
+
+  private:
+    std::array<Sample, Capacity> m_values{};
+    double m_sum = 0;
+    double m_scale = 1;
+    std::uint32_t m_w = 0;
+    std::uint32_t m_length = 1;
+};
+
+}
+}
+
+#endif /* SLIDING_WINDOW_H */
@@ -0,0 +1,93 @@
+#ifndef SVF_BANK_H
+#define SVF_BANK_H
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <audio_processor.h>
+#include <simd.h>
+
+namespace awesomefx
+{
+namespace dsp
+{
+
+// A bank of state variable filters fed by one input, four bands per vector
+// in structure of arrays layout. These are the trapezoidal (TPT) SVFs of
+// V. Zavalishin, The Art of VA Filter Design, which unlike the Chamberlin
+// form in svf.cc stay stable up to Nyquist, so a bank can span the range.
+template<std::size_t Bands>
+class SvfBank
+{
+  static_assert(Bands > 0 && Bands % 4 == 0, "Bands come in groups of four");
+
+  public:
+    static constexpr std::size_t Groups = Bands / 4;
+
+    // Calls std::tan, control thread or construction only
+    void setFrequencies(const std::array<float, Bands>& frequencies, float fs)
+    {
+      for (auto band = 0U; band < Bands; ++band)
+      {
+        const auto f = std::min(frequencies[band], 0.49f * fs);
+        m_g[band / 4][band % 4] = std::tan(M_PI * f / fs);
+      }
+      setResonance(m_q);
+    }
+
+    // Same Q for every band, RT safe
+    void setResonance(float q)
+    {
+      m_q = q;
+      const auto k = broadcast(1 / q);
+      for (auto i = 0U; i < Groups; ++i)
+      {
+        const auto g = m_g[i];
+        m_a1[i] = 1.0f / (1.0f + g * (g + k));
+        m_a2[i] = g * m_a1[i];
+        m_a3[i] = g * m_a2[i];
+      }
+      m_k = k;
+    }
+
+    void reset()
+    {
+      for (auto i = 0U; i < Groups; ++i)
+      {
+        m_ic1[i] = Vec4{};
+        m_ic2[i] = Vec4{};
+      }
+    }
+
+    // One sample through every band. Band pass outputs, unity gain at the
+    // band centre, one vector per group of four bands.
+    void bandpass(Sample in, Vec4* out)
+    {
+      const auto x = broadcast(in);
+      for (auto i = 0U; i < Groups; ++i)
+      {
+        const auto v3 = x - m_ic2[i];
+        const auto v1 = m_a1[i] * m_ic1[i] + m_a2[i] * v3;
+        const auto v2 = m_ic2[i] + m_a2[i] * m_ic1[i] + m_a3[i] * v3;
+        m_ic1[i] = 2.0f * v1 - m_ic1[i];
+        m_ic2[i] = 2.0f * v2 - m_ic2[i];
+        out[i] = m_k * v1;
+      }
+    }
+
+  private:
+    std::array<Vec4, Groups> m_g{};
+    std::array<Vec4, Groups> m_a1{};
+    std::array<Vec4, Groups> m_a2{};
+    std::array<Vec4, Groups> m_a3{};
+    std::array<Vec4, Groups> m_ic1{};
+    std::array<Vec4, Groups> m_ic2{};
+    Vec4 m_k{};
+    float m_q = 0.707f;
+};
+
+}
+}
+
+#endif /* SVF_BANK_H */
@@ -1,7 +1,8 @@
 #include <audio_processor.h>
 #include <fx_plugin.h>
+#include <delay_line.h>
+#include <oscillator.h>
 #include <memory>
-#include <cmath>
 
 namespace awesomefx
 {
@@ -16,36 +17,7 @@ namespace awesomefx
     const int Depth = 1;
     const int DryWet = 2;
 
-    class DelayLine
-    {
-      public:
-        DelayLine(std::size_t size)
-        {
-          m_buffer.resize(size);
-          std::fill(m_buffer.begin(), m_buffer.end(), 0);
-        }
-
-        void write(Sample s)
-        {
-          m_buffer[m_w++] = s;
-          if (m_w >= m_buffer.size()) m_w = 0;
-        }
-
-        Sample read(float delay)
-        {
-          auto r = m_w - delay;
-          if (r < 0) r += m_buffer.size();
-          int i = r;
-          float f = r - i;
-          auto s1 = m_buffer[i];
-          if (++i >= m_buffer.size()) i = 0;
-          return s1 + (m_buffer[i] - s1) * f;
-        }
-
-      private:
-        std::vector<Sample> m_buffer;
-        std::uint32_t m_w = 0;
-    };
+    using DelayLine = dsp::DelayLine<DelayBufferSize, dsp::Interpolation::Linear>;
   }
 
   class Chorus : public AudioProcessor
@@ -69,8 +41,8 @@ namespace awesomefx
           m_delayLine1_r.write(right);
           m_delayLine2_r.write(right);
 
-          auto mod_l = 0.25 * DelayBufferSize * std::sin(2.0 * 3.141592 * m_phase) * m_depth;
-          auto mod_r = 0.25 * DelayBufferSize * std::sin(2.0 * 3.141592 * m_phase * 0.8) * m_depth;
+          auto mod_l = 0.25f * DelayBufferSize * m_lfo_l.next() * m_depth;
+          auto mod_r = 0.25f * DelayBufferSize * m_lfo_r.next() * m_depth;
 
           auto wet_l = 0.5 * m_delayLine1_l.read(Delay1 + mod_l) +
                        0.5 * m_delayLine2_l.read(Delay2 + mod_l);
@@ -80,8 +52,6 @@ namespace awesomefx
 
           *out_l++ = m_drywet * wet_l + (1 - m_drywet) * left;
           *out_r++ = m_drywet * wet_r + (1 - m_drywet) * right;
-
-          m_phase += m_step;
         }
       }
 
@@ -90,7 +60,9 @@ namespace awesomefx
         switch (param.index)
         {
           case Rate:
-            m_step = 5.0 * param.value / m_fs;
+            // The right side runs slightly slower to decorrelate the channels
+            m_lfo_l.setFrequency(5.0f * param.value, m_fs);
+            m_lfo_r.setFrequency(4.0f * param.value, m_fs);
             break;
           case Depth:
             m_depth = param.value * 0.15;
@@ -103,13 +75,13 @@ namespace awesomefx
         }
       }
 
-      DelayLine m_delayLine1_l{DelayBufferSize};
-      DelayLine m_delayLine2_l{DelayBufferSize};
-      DelayLine m_delayLine1_r{DelayBufferSize};
-      DelayLine m_delayLine2_r{DelayBufferSize};
-      float m_phase = 0;
+      DelayLine m_delayLine1_l;
+      DelayLine m_delayLine2_l;
+      DelayLine m_delayLine1_r;
+      DelayLine m_delayLine2_r;
+      dsp::ControlRateLfo<> m_lfo_l;
+      dsp::ControlRateLfo<> m_lfo_r;
       std::uint32_t m_fs;
-      float m_step = 0;
       float m_depth = 0;
       float m_drywet = 0;
   };
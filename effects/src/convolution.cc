@@ -0,0 +1,641 @@
+#include <audio_processor.h>
+#include <fx_plugin.h>
+#include <fft.h>
+#include <simd.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <dirent.h>
+#include <memory>
+#include <semaphore.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace awesomefx
+{
+
+namespace
+{
+const std::uint32_t Impulse = 0;
+const std::uint32_t DryWet = 1;
+
+// Taps [0, HeadSize) run as a direct FIR, [HeadSize, LongOffset) as short
+// partitions on the RT thread and the rest as long partitions on a worker
+// thread, which gets one long block of time to deliver each result
+const std::size_t HeadSize = 64;
+const std::size_t ShortBlock = 64;
+const std::size_t LongBlock = 1024;
+const std::size_t LongOffset = 2 * LongBlock;
+
+const float MaxSeconds = 10;
+const char* IrDirVariable = "AWESOMEFX_IR_DIR";
+const char* DefaultIrDir = "irs";
+
+using Channels = std::array<std::vector<float>, 2>;
+
+// Uniformly partitioned overlap-save convolution of one IR segment. Each
+// call consumes one input block and returns the segment's contribution to
+// a later output block, offset / block blocks after the one just consumed.
+class UniformLevel
+{
+  public:
+    UniformLevel(const std::vector<float>& ir, std::size_t offset, std::size_t end, std::size_t block)
+      : m_block(block)
+      , m_fft(2 * block)
+      , m_bins(m_fft.bins())
+      , m_window(2 * block)
+      , m_output(2 * block)
+      , m_accRe(m_bins)
+      , m_accIm(m_bins)
+    {
+      end = std::min(end, ir.size());
+      m_partitions = end > offset ? (end - offset + block - 1) / block : 0;
+      m_irRe.resize(m_partitions * m_bins);
+      m_irIm.resize(m_partitions * m_bins);
+      m_inRe.resize(m_partitions * m_bins);
+      m_inIm.resize(m_partitions * m_bins);
+
+      for (auto k = 0U; k < m_partitions; ++k)
+      {
+        std::fill(m_window.begin(), m_window.end(), 0.0f);
+        const auto first = offset + k * block;
+        std::copy(ir.begin() + first, ir.begin() + std::min(first + block, end), m_window.begin());
+        m_fft.forward(m_window.data(), &m_irRe[k * m_bins], &m_irIm[k * m_bins]);
+      }
+      std::fill(m_window.begin(), m_window.end(), 0.0f);
+    }
+
+    bool empty() const
+    {
+      return m_partitions == 0;
+    }
+
+    // Forgets the input history, as if it had been silent
+    void reset()
+    {
+      std::fill(m_window.begin(), m_window.end(), 0.0f);
+      std::fill(m_inRe.begin(), m_inRe.end(), 0.0f);
+      std::fill(m_inIm.begin(), m_inIm.end(), 0.0f);
+      m_head = 0;
+    }
+
+    // RT safe
+    void process(const float* in, float* out)
+    {
+      if (empty())
+      {
+        std::fill_n(out, m_block, 0.0f);
+        return;
+      }
+
+      std::copy_n(m_window.begin() + m_block, m_block, m_window.begin());
+      std::copy_n(in, m_block, m_window.begin() + m_block);
+      m_fft.forward(m_window.data(), &m_inRe[m_head * m_bins], &m_inIm[m_head * m_bins]);
+
+      std::fill(m_accRe.begin(), m_accRe.end(), 0.0f);
+      std::fill(m_accIm.begin(), m_accIm.end(), 0.0f);
+      auto slot = m_head;
+      for (auto k = 0U; k < m_partitions; ++k)
+      {
+        dsp::multiplyAdd(m_accRe.data(), m_accIm.data(), &m_inRe[slot * m_bins], &m_inIm[slot * m_bins],
+                         &m_irRe[k * m_bins], &m_irIm[k * m_bins], m_bins);
+        slot = slot == 0 ? m_partitions - 1 : slot - 1;
+      }
+      m_head = m_head + 1 == m_partitions ? 0 : m_head + 1;
+
+      // The first half of the circular result is aliased, the second is valid
+      m_fft.inverse(m_accRe.data(), m_accIm.data(), m_output.data());
+      std::copy_n(m_output.begin() + m_block, m_block, out);
+    }
+
+  private:
+    std::size_t m_block;
+    dsp::RealFft m_fft;
+    std::size_t m_bins;
+    std::size_t m_partitions;
+    std::size_t m_head = 0;
+    dsp::AlignedVector<float> m_window;
+    dsp::AlignedVector<float> m_output;
+    dsp::AlignedVector<float> m_accRe;
+    dsp::AlignedVector<float> m_accIm;
+    dsp::AlignedVector<float> m_irRe;
+    dsp::AlignedVector<float> m_irIm;
+    dsp::AlignedVector<float> m_inRe;
+    dsp::AlignedVector<float> m_inIm;
+};
+
+// Zero latency convolution of one stereo IR
+class Engine
+{
+  public:
+    Engine(const Channels& ir)
+      : m_channels{ { { ir[0] }, { ir[1] } } }
+    {
+      m_hasTail = !m_channels[0].longLevel.empty() || !m_channels[1].longLevel.empty();
+      if (m_hasTail)
+      {
+        ::sem_init(&m_jobs, 0, 0);
+        m_worker = std::thread([this] { work(); });
+      }
+    }
+
+    ~Engine()
+    {
+      if (m_hasTail)
+      {
+        m_running = false;
+        ::sem_post(&m_jobs);
+        m_worker.join();
+        ::sem_destroy(&m_jobs);
+      }
+    }
+
+    // RT safe, adds nothing but the wet signal
+    void process(const Sample* in_l, const Sample* in_r, Sample* out_l, Sample* out_r, std::size_t numSamples)
+    {
+      const std::array<const Sample*, 2> in{ in_l, in_r };
+      const std::array<Sample*, 2> out{ out_l, out_r };
+
+      for (auto i = 0U; i < numSamples; ++i)
+      {
+        const auto longSlot = m_longBlock & 1;
+
+        for (auto c = 0U; c < m_channels.size(); ++c)
+        {
+          auto& channel = m_channels[c];
+          const auto x = in[c][i];
+
+          channel.history[m_headPosition] = channel.history[m_headPosition + HeadSize] = x;
+          const auto* window = &channel.history[m_headPosition + 1];
+          auto y = 0.0f;
+          for (auto k = 0U; k < HeadSize; ++k)
+          {
+            y += channel.head[k] * window[k];
+          }
+
+          y += channel.shortOutput[m_shortPosition];
+          if (m_longValid)
+          {
+            y += channel.longOutput[longSlot][m_longPosition];
+          }
+
+          channel.shortInput[m_shortPosition] = x;
+          channel.longInput[longSlot][m_longPosition] = x;
+          out[c][i] = y;
+        }
+
+        m_headPosition = m_headPosition + 1 == HeadSize ? 0 : m_headPosition + 1;
+
+        if (++m_shortPosition == ShortBlock)
+        {
+          m_shortPosition = 0;
+          for (auto& channel : m_channels)
+          {
+            channel.shortLevel.process(channel.shortInput.data(), channel.shortOutput.data());
+          }
+        }
+
+        if (++m_longPosition == LongBlock)
+        {
+          m_longPosition = 0;
+          if (m_hasTail)
+          {
+            m_submitted.store(m_longBlock, std::memory_order_release);
+            ::sem_post(&m_jobs);
+          }
+
+          ++m_longBlock;
+          m_longValid = m_ready.load(std::memory_order_acquire) == m_longBlock;
+        }
+      }
+    }
+
+  private:
+    struct Channel
+    {
+      Channel(const std::vector<float>& ir)
+        : shortLevel(ir, HeadSize, LongOffset, ShortBlock)
+        , longLevel(ir, LongOffset, ir.size(), LongBlock)
+      {
+        // Reversed so the FIR runs over the history in time order
+        for (auto k = 0U; k < std::min(HeadSize, ir.size()); ++k)
+        {
+          head[HeadSize - 1 - k] = ir[k];
+        }
+      }
+
+      std::array<float, HeadSize> head{};
+      std::array<float, 2 * HeadSize> history{};
+      UniformLevel shortLevel;
+      std::array<float, ShortBlock> shortInput{};
+      std::array<float, ShortBlock> shortOutput{};
+      UniformLevel longLevel;
+      std::array<std::array<float, LongBlock>, 2> longInput{};
+      std::array<std::array<float, LongBlock>, 2> longOutput{};
+    };
+
+    // Processes every submitted block once and in order. Block b contributes
+    // to output block b + 2, which is played from the output slot of the
+    // same parity. Its input slot is refilled from block b + 2 on, so a
+    // worker that falls further behind than that has lost input: it starts
+    // over from silence at the newest block, and the blocks it skipped play
+    // without a tail.
+    void work()
+    {
+      std::uint64_t next = 0;
+
+      while (true)
+      {
+        ::sem_wait(&m_jobs);
+        if (!m_running)
+        {
+          break;
+        }
+
+        std::uint64_t submitted;
+        while (next <= (submitted = m_submitted.load(std::memory_order_acquire)))
+        {
+          if (submitted > next)
+          {
+            flush();
+            next = submitted;
+          }
+
+          for (auto& channel : m_channels)
+          {
+            channel.longLevel.process(channel.longInput[next & 1].data(), channel.longOutput[next & 1].data());
+          }
+
+          // The RT thread moved on to refill the slot while it was read
+          if (m_submitted.load(std::memory_order_acquire) > next)
+          {
+            flush();
+          }
+          else
+          {
+            m_ready.store(next + 2, std::memory_order_release);
+          }
+          ++next;
+        }
+      }
+    }
+
+    void flush()
+    {
+      for (auto& channel : m_channels)
+      {
+        channel.longLevel.reset();
+      }
+    }
+
+    std::array<Channel, 2> m_channels;
+    std::size_t m_headPosition = 0;
+    std::size_t m_shortPosition = 0;
+    std::size_t m_longPosition = 0;
+    std::uint64_t m_longBlock = 0;
+    bool m_longValid = false;
+    bool m_hasTail = false;
+    std::atomic<std::uint64_t> m_submitted{0};
+    std::atomic<std::uint64_t> m_ready{0};
+    std::atomic<bool> m_running{true};
+    sem_t m_jobs;
+    std::thread m_worker;
+};
+
+std::uint32_t readLe(const unsigned char* p, std::size_t bytes)
+{
+  std::uint32_t value = 0;
+  for (auto i = 0U; i < bytes; ++i)
+  {
+    value |= static_cast<std::uint32_t>(p[i]) << (8 * i);
+  }
+  return value;
+}
+
+// Reads a PCM (16, 24 or 32 bit) or 32 bit float WAV file into one or two
+// channels at the file's own sample rate
+bool readWav(const std::string& path, Channels& channels, std::uint32_t& sampleRate)
+{
+  auto file = std::fopen(path.c_str(), "rb");
+  if (!file)
+  {
+    return false;
+  }
+
+  std::vector<unsigned char> data;
+  unsigned char chunk[4096];
+  std::size_t count;
+  while ((count = std::fread(chunk, 1, sizeof(chunk), file)) > 0)
+  {
+    data.insert(data.end(), chunk, chunk + count);
+  }
+  std::fclose(file);
+
+  if (data.size() < 12 || std::memcmp(&data[0], "RIFF", 4) || std::memcmp(&data[8], "WAVE", 4))
+  {
+    return false;
+  }
+
+  std::uint32_t format = 0, numChannels = 0, bits = 0;
+  const unsigned char* samples = nullptr;
+  std::size_t sampleBytes = 0;
+
+  for (std::size_t pos = 12; pos + 8 <= data.size();)
+  {
+    const auto size = std::min<std::size_t>(readLe(&data[pos + 4], 4), data.size() - pos - 8);
+    const auto* body = &data[pos + 8];
+
+    if (!std::memcmp(&data[pos], "fmt ", 4) && size >= 16)
+    {
+      format = readLe(body, 2);
+      numChannels = readLe(body + 2, 2);
+      sampleRate = readLe(body + 4, 4);
+      bits = readLe(body + 14, 2);
+      if (format == 0xFFFE && size >= 26)
+      {
+        format = readLe(body + 24, 2);
+      }
+    }
+    else if (!std::memcmp(&data[pos], "data", 4))
+    {
+      samples = body;
+      sampleBytes = size;
+    }
+
+    pos += 8 + size + (size & 1);
+  }
+
+  const auto bytes = bits / 8;
+  const auto supported = (format == 1 && (bits == 16 || bits == 24 || bits == 32)) || (format == 3 && bits == 32);
+  if (!samples || !supported || numChannels == 0 || sampleRate == 0)
+  {
+    return false;
+  }
+
+  const auto frames = sampleBytes / (bytes * numChannels);
+  for (auto c = 0U; c < channels.size(); ++c)
+  {
+    const auto source = std::min<std::uint32_t>(c, numChannels - 1);
+    auto& channel = channels[c];
+    channel.resize(frames);
+
+    for (auto i = 0U; i < frames; ++i)
+    {
+      const auto* p = samples + (i * numChannels + source) * bytes;
+      const auto raw = readLe(p, bytes);
+
+      if (format == 3)
+      {
+        std::memcpy(&channel[i], &raw, sizeof(float));
+      }
+      else
+      {
+        // Sign extend from the top and scale to [-1, 1)
+        const auto value = static_cast<std::int32_t>(raw << (32 - bits));
+        channel[i] = value / 2147483648.0f;
+      }
+    }
+  }
+
+  return true;
+}
+
+// Resamples to the running rate, trims and normalises to unit energy
+void prepare(Channels& channels, std::uint32_t fileRate, std::uint32_t sampleRate)
+{
+  const auto maxLength = static_cast<std::size_t>(MaxSeconds * sampleRate);
+  auto energy = 0.0;
+
+  for (auto& channel : channels)
+  {
+    if (fileRate != sampleRate)
+    {
+      const auto ratio = static_cast<double>(fileRate) / sampleRate;
+      std::vector<float> resampled(static_cast<std::size_t>(channel.size() / ratio));
+      for (auto i = 0U; i < resampled.size(); ++i)
+      {
+        const auto position = i * ratio;
+        const auto index = static_cast<std::size_t>(position);
+        const auto fraction = static_cast<float>(position - index);
+        const auto next = index + 1 < channel.size() ? channel[index + 1] : 0.0f;
+        resampled[i] = channel[index] + (next - channel[index]) * fraction;
+      }
+      channel = std::move(resampled);
+    }
+
+    if (channel.size() > maxLength)
+    {
+      channel.resize(maxLength);
+    }
+
+    auto channelEnergy = 0.0;
+    for (auto s : channel)
+    {
+      channelEnergy += s * s;
+    }
+    energy = std::max(energy, channelEnergy);
+  }
+
+  if (energy > 0)
+  {
+    const auto gain = static_cast<float>(1 / std::sqrt(energy));
+    for (auto& channel : channels)
+    {
+      for (auto& s : channel)
+      {
+        s *= gain;
+      }
+    }
+  }
+}
+
+std::vector<std::string> listImpulses(const std::string& dir)
+{
+  std::vector<std::string> files;
+  if (auto handle = ::opendir(dir.c_str()))
+  {
+    while (auto entry = ::readdir(handle))
+    {
+      std::string name = entry->d_name;
+      if (name.size() > 4 && name.compare(name.size() - 4, 4, ".wav") == 0)
+      {
+        files.push_back(dir + "/" + name);
+      }
+    }
+    ::closedir(handle);
+  }
+
+  std::sort(files.begin(), files.end());
+  return files;
+}
+
+}
+
+  class Convolution : public AudioProcessor
+  {
+    public:
+      Convolution(const AudioProcessingContext& context)
+        : m_fs(context.getSampleRate())
+      {
+        auto dir = std::getenv(IrDirVariable);
+        m_dir = dir ? dir : DefaultIrDir;
+
+        ::sem_init(&m_requests, 0, 0);
+        m_loader = std::thread([this] { load(); });
+        ::sem_post(&m_requests);
+      }
+
+      ~Convolution()
+      {
+        m_running = false;
+        ::sem_post(&m_requests);
+        m_loader.join();
+        ::sem_destroy(&m_requests);
+
+        delete m_pending.exchange(nullptr);
+        delete m_retired.exchange(nullptr);
+      }
+
+      void process(Sample* in_l, Sample* in_r, Sample* out_l, Sample* out_r, std::size_t numSamples) override
+      {
+        // The loader reaps the old engine, one swap at a time
+        if (!m_retired.load(std::memory_order_acquire))
+        {
+          if (auto next = m_pending.exchange(nullptr, std::memory_order_acq_rel))
+          {
+            m_retired.store(m_engine.release(), std::memory_order_release);
+            m_engine.reset(next);
+          }
+        }
+
+        const auto wet = m_dryWet;
+        const auto dry = 1 - m_dryWet;
+
+        if (!m_engine)
+        {
+          for (auto i = 0U; i < numSamples; ++i)
+          {
+            out_l[i] = in_l[i] * dry;
+            out_r[i] = in_r[i] * dry;
+          }
+          return;
+        }
+
+        m_engine->process(in_l, in_r, out_l, out_r, numSamples);
+        for (auto i = 0U; i < numSamples; ++i)
+        {
+          out_l[i] = out_l[i] * wet + in_l[i] * dry;
+          out_r[i] = out_r[i] * wet + in_r[i] * dry;
+        }
+      }
+
+      void setParameter(const AudioProcessor::Parameter& param) override
+      {
+        switch (param.index)
+        {
+          case Impulse:
+            m_requested.store(param.value, std::memory_order_relaxed);
+            ::sem_post(&m_requests);
+            break;
+          case DryWet:
+            m_dryWet = param.value;
+            break;
+          default:
+            break;
+        }
+      }
+
+    private:
+      // Runs off the RT thread: reads the WAV, builds the engine and hands it over
+      void load()
+      {
+        auto loaded = -1.0f;
+
+        while (true)
+        {
+          timespec deadline;
+          ::clock_gettime(CLOCK_REALTIME, &deadline);
+          deadline.tv_nsec += 50 * 1000 * 1000;
+          if (deadline.tv_nsec >= 1000 * 1000 * 1000)
+          {
+            deadline.tv_sec += 1;
+            deadline.tv_nsec -= 1000 * 1000 * 1000;
+          }
+          ::sem_timedwait(&m_requests, &deadline);
+
+          delete m_retired.exchange(nullptr, std::memory_order_acq_rel);
+
+          if (!m_running)
+          {
+            break;
+          }
+
+          const auto requested = m_requested.load(std::memory_order_relaxed);
+          if (requested == loaded)
+          {
+            continue;
+          }
+          loaded = requested;
+
+          const auto files = listImpulses(m_dir);
+          if (files.empty())
+          {
+            std::printf("Convolution: no impulse responses in %s\n", m_dir.c_str());
+            continue;
+          }
+
+          const auto index = std::min<std::size_t>(requested * files.size(), files.size() - 1);
+          Channels channels;
+          std::uint32_t fileRate = 0;
+          if (!readWav(files[index], channels, fileRate))
+          {
+            std::printf("Convolution: failed to read %s\n", files[index].c_str());
+            continue;
+          }
+
+          prepare(channels, fileRate, m_fs);
+          delete m_pending.exchange(new Engine(channels), std::memory_order_acq_rel);
+        }
+      }
+
+      std::uint32_t m_fs;
+      std::string m_dir;
+      float m_dryWet = 0;
+      std::unique_ptr<Engine> m_engine;
+      std::atomic<Engine*> m_pending{nullptr};
+      std::atomic<Engine*> m_retired{nullptr};
+      std::atomic<float> m_requested{0};
+      std::atomic<bool> m_running{true};
+      sem_t m_requests;
+      std::thread m_loader;
+  };
+
+  class ConvolutionPlugin : public FxPlugin
+  {
+    public:
+      FxPluginInfo getPluginInfo() const override
+      {
+        return {"Convolution", {"Impulse", "Dry/Wet"}};
+      }
+
+      AudioProcessor::Ptr createAudioProcessor(const AudioProcessingContext& context) const override
+      {
+        return std::make_unique<Convolution>(context);
+      }
+  };
+
+}
+
+using namespace awesomefx;
+
+extern "C" FxPlugin::Ptr createFxPlugin()
+{
+  return std::make_unique<ConvolutionPlugin>();
+}
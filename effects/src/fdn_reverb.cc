@@ -0,0 +1,267 @@
+#include <audio_processor.h>
+#include <fx_plugin.h>
+#include <delay_arena.h>
+#include <oscillator.h>
+#include <simd.h>
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <cmath>
+
+namespace awesomefx
+{
+
+namespace
+{
+const std::uint32_t Size = 0;
+const std::uint32_t Decay = 1;
+const std::uint32_t Damping = 2;
+const std::uint32_t Modulation = 3;
+const std::uint32_t DryWet = 4;
+
+const std::size_t Lines = 8;
+const std::size_t BlockSize = 32;
+
+// Mutually prime line lengths at 48 kHz and full size, 21 to 59 ms
+const std::array<float, Lines> BaseDelays{ 1031, 1327, 1523, 1783, 1999, 2251, 2459, 2819 };
+const float BaseRate = 48000;
+const float MinSize = 0.3;
+const float MaxExcursion = 12;
+const float ModFrequency = 0.7;
+
+using dsp::Vec4;
+using dsp::Vec4u;
+
+// Lanes of two four wide halves, lines 0-3 and 4-7
+struct Vec8x
+{
+  Vec4 lo;
+  Vec4 hi;
+};
+
+inline Vec4 hadamard4(Vec4 v)
+{
+  const Vec4 s1{1, -1, 1, -1};
+  const Vec4 s2{1, 1, -1, -1};
+  v = v * s1 + __builtin_shuffle(v, dsp::Vec4i{1, 0, 3, 2});
+  v = v * s2 + __builtin_shuffle(v, dsp::Vec4i{2, 3, 0, 1});
+  return v;
+}
+
+// Linear interpolation between the two samples around each delay
+inline Vec4 read(const dsp::DelayArena& arena, Vec4u bases, Vec4 delays)
+{
+  // Signed conversion has a native instruction, unsigned does not
+  const auto whole = __builtin_convertvector(delays, dsp::Vec4i);
+  const auto fraction = delays - __builtin_convertvector(whole, Vec4);
+  const auto offsets = bases + reinterpret_cast<const Vec4u&>(whole);
+  const auto a = arena.read(offsets);
+  const auto b = arena.read(offsets + 1);
+  return a + (b - a) * fraction;
+}
+
+inline float sum(Vec4 v)
+{
+  return (v[0] + v[1]) + (v[2] + v[3]);
+}
+
+}
+
+  // Eight line feedback delay network. The lines are mixed by a normalised
+  // 8x8 Hadamard matrix, evaluated as a fast Walsh-Hadamard transform on two
+  // four wide halves. Lines 0-3 are modulated and read with interpolation,
+  // lines 4-7 have fixed whole sample delays.
+  class FdnReverb : public AudioProcessor
+  {
+    public:
+      FdnReverb(const AudioProcessingContext& context)
+        : m_fs(context.getSampleRate())
+        , m_rateRatio(m_fs / BaseRate)
+      {
+        for (auto i = 0U; i < Lines; ++i)
+        {
+          // Room for the longest delay, the excursion and the interpolation
+          auto length = static_cast<std::uint32_t>(std::ceil((BaseDelays[i] + MaxExcursion) * m_rateRatio)) + 2;
+          (i < 4 ? m_modulatedBases : m_fixedBases)[i % 4] = m_arena.reserve(length).base;
+        }
+        m_arena.allocate();
+
+        m_lfo.setFrequency(ModFrequency, m_fs);
+
+        updateDelays();
+        for (auto i = 0U; i < 4; ++i)
+        {
+          m_modulatedDelays[i] = m_targets[i];
+        }
+        updateGains();
+      }
+
+      void process(Sample* in_l, Sample* in_r, Sample* out_l, Sample* out_r, std::size_t numSamples) override
+      {
+        while (numSamples)
+        {
+          const auto n = std::min(numSamples, BlockSize);
+          processBlock(in_l, in_r, out_l, out_r, n);
+
+          in_l += n;
+          in_r += n;
+          out_l += n;
+          out_r += n;
+          numSamples -= n;
+        }
+      }
+
+      void setParameter(const AudioProcessor::Parameter& param) override
+      {
+        switch (param.index)
+        {
+          case Size:
+            m_size = MinSize + (1 - MinSize) * param.value;
+            updateDelays();
+            updateGains();
+            break;
+          case Decay:
+            // 0.2 to 10 seconds
+            m_decayTime = 0.2f * std::pow(50.0f, param.value);
+            updateGains();
+            break;
+          case Damping:
+            m_damping = 0.9f * param.value;
+            break;
+          case Modulation:
+            m_modDepth = MaxExcursion * m_rateRatio * param.value;
+            break;
+          case DryWet:
+            m_dryWet = param.value;
+            break;
+          default:
+            break;
+        }
+      }
+
+    private:
+      void updateDelays()
+      {
+        for (auto i = 0U; i < Lines; ++i)
+        {
+          m_targets[i] = BaseDelays[i] * m_size * m_rateRatio;
+        }
+
+        for (auto i = 0U; i < 4; ++i)
+        {
+          m_fixedOffsets[i] = m_fixedBases[i] + static_cast<std::uint32_t>(m_targets[i + 4] + 0.5f);
+        }
+      }
+
+      // Per-line loss so every line decays 60 dB in the decay time. The
+      // Hadamard normalisation is folded in.
+      void updateGains()
+      {
+        const auto scale = 1.0f / std::sqrt(static_cast<float>(Lines));
+        for (auto i = 0U; i < Lines; ++i)
+        {
+          auto gain = std::pow(10.0f, -3.0f * m_targets[i] / (m_decayTime * m_fs));
+          (i < 4 ? m_gains.lo : m_gains.hi)[i % 4] = gain * scale;
+        }
+      }
+
+      void processBlock(const Sample* in_l, const Sample* in_r, Sample* out_l, Sample* out_r, std::size_t numSamples)
+      {
+        // Modulated delays ramp towards their targets over the block, which
+        // also glides Size changes
+        const auto mod = m_lfo.next(numSamples);
+        const Vec4 excursions{ mod.sin, mod.cos, -mod.sin, -mod.cos };
+
+        Vec4 steps;
+        for (auto i = 0U; i < 4; ++i)
+        {
+          steps[i] = (m_targets[i] + m_modDepth * excursions[i] - m_modulatedDelays[i]) / numSamples;
+        }
+
+        const Vec4 inputSigns{0.5, -0.5, 0.5, -0.5};
+        const Vec4 leftSigns{1, 1, -1, -1};
+        const Vec4 rightSigns{1, -1, -1, 1};
+        const auto damping = dsp::broadcast(m_damping);
+        const auto wet = m_dryWet;
+        const auto dry = 1 - m_dryWet;
+
+        // Kept in locals, the arena writes could otherwise alias them
+        const auto modulatedBases = m_modulatedBases;
+        const auto fixedBases = m_fixedBases;
+        const auto fixedOffsets = m_fixedOffsets;
+        const auto gains = m_gains;
+        auto delays = m_modulatedDelays;
+        auto state = m_state;
+
+        for (auto n = 0U; n < numSamples; ++n)
+        {
+          m_arena.advance();
+
+          delays += steps;
+          Vec8x v{ read(m_arena, modulatedBases, delays), m_arena.read(fixedOffsets) };
+
+          // Per-line damping and loss
+          state.lo = v.lo + damping * (state.lo - v.lo);
+          state.hi = v.hi + damping * (state.hi - v.hi);
+          v.lo = state.lo * gains.lo;
+          v.hi = state.hi * gains.hi;
+
+          const auto wet_l = sum((v.lo + v.hi) * leftSigns);
+          const auto wet_r = sum((v.lo - v.hi) * rightSigns);
+
+          // H8 = [H4 H4; H4 -H4]
+          const auto lo = hadamard4(v.lo);
+          const auto hi = hadamard4(v.hi);
+          const auto in = (in_l[n] + in_r[n]) * inputSigns;
+
+          m_arena.write(modulatedBases, lo + hi + in);
+          m_arena.write(fixedBases, lo - hi + in);
+
+          out_l[n] = wet_l * wet + in_l[n] * dry;
+          out_r[n] = wet_r * wet + in_r[n] * dry;
+        }
+
+        m_modulatedDelays = delays;
+        m_state = state;
+      }
+
+      std::uint32_t m_fs;
+      float m_rateRatio;
+      dsp::DelayArena m_arena;
+      Vec4u m_modulatedBases{};
+      Vec4u m_fixedBases{};
+      Vec4u m_fixedOffsets{};
+      std::array<float, Lines> m_targets{};
+      Vec4 m_modulatedDelays{};
+      Vec8x m_gains{};
+      Vec8x m_state{};
+      dsp::QuadratureOscillator m_lfo;
+      float m_size = 1;
+      float m_decayTime = 2;
+      float m_damping = 0.3;
+      float m_modDepth = 0;
+      float m_dryWet = 0;
+  };
+
+  class FdnReverbPlugin : public FxPlugin
+  {
+    public:
+      FxPluginInfo getPluginInfo() const override
+      {
+        return {"FDN Reverb", {"Size", "Decay", "Damping", "Modulation", "Dry/Wet"}};
+      }
+
+      AudioProcessor::Ptr createAudioProcessor(const AudioProcessingContext& context) const override
+      {
+        return std::make_unique<FdnReverb>(context);
+      }
+  };
+
+}
+
+using namespace awesomefx;
+
+extern "C" FxPlugin::Ptr createFxPlugin()
+{
+  return std::make_unique<FdnReverbPlugin>();
+}
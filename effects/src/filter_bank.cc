@@ -0,0 +1,295 @@
+#include <audio_processor.h>
+#include <fx_plugin.h>
+#include <simd.h>
+#include <svf_bank.h>
+#include <array>
+#include <cmath>
+#include <memory>
+
+namespace awesomefx
+{
+
+namespace
+{
+const std::uint32_t Mode = 0;
+const std::uint32_t Bandwidth = 1;
+const std::uint32_t Attack = 2;
+const std::uint32_t Release = 3;
+const std::uint32_t Threshold = 4;
+const std::uint32_t Output = 5;
+const std::uint32_t DryWet = 6;
+
+const std::size_t Bands = 32;
+const float LowestBand = 80;
+const float HighestBand = 12000;
+
+// Bandwidth 0 is the narrowest
+const float MaxQuality = 20;
+const float MinQuality = 2;
+
+const float MinAttack = 0.001;
+const float MaxAttack = 0.1;
+const float MinRelease = 0.01;
+const float MaxRelease = 1;
+const float MinThresholdDb = -80;
+const float MaxOutputDb = 24;
+
+// Gate gains move over a few ms so bands do not click open and shut
+const float GateTime = 0.002;
+
+// The output scales with both inputs; with both around -10 dBFS it is
+// about as loud as the carrier
+const float VocoderMakeup = 36;
+
+using Bank = dsp::SvfBank<Bands>;
+using dsp::Vec4;
+using dsp::broadcast;
+
+inline Vec4 abs(Vec4 x)
+{
+  return x < 0 ? -x : x;
+}
+
+inline float sum(Vec4 x)
+{
+  return (x[0] + x[1]) + (x[2] + x[3]);
+}
+
+inline float timeToCoefficient(float seconds, float fs)
+{
+  return 1 - std::exp(-1 / (seconds * fs));
+}
+}
+
+// Vocoder: the left input modulates, the right input is the carrier, and
+// the output is the carrier's bands weighted by the modulator's band
+// envelopes. Spectral gate: the stereo input is resynthesised from the
+// bands whose envelope is over the threshold.
+class FilterBank : public AudioProcessor
+{
+  public:
+    FilterBank(const AudioProcessingContext& context)
+      : m_fs(context.getSampleRate())
+      , m_gateCoefficient(broadcast(timeToCoefficient(GateTime, m_fs)))
+    {
+      std::array<float, Bands> frequencies;
+      for (auto band = 0U; band < Bands; ++band)
+      {
+        frequencies[band] = LowestBand * std::pow(HighestBand / LowestBand, band / (Bands - 1.0f));
+      }
+      m_spacing = std::log(frequencies[1] / frequencies[0]);
+
+      for (auto* bank : { &m_left, &m_right })
+      {
+        bank->setFrequencies(frequencies, m_fs);
+      }
+
+      for (auto index : { Bandwidth, Attack, Release, Threshold, Output })
+      {
+        setParameter({index, 0.5});
+      }
+      reset();
+    }
+
+    void process(Sample* in_l, Sample* in_r, Sample* out_l, Sample* out_r, std::size_t numSamples) override
+    {
+      if (m_vocoder)
+      {
+        vocode(in_l, in_r, out_l, out_r, numSamples);
+      }
+      else
+      {
+        gate(in_l, in_r, out_l, out_r, numSamples);
+      }
+
+      const auto wet = m_dryWet * m_output;
+      const auto dry = 1 - m_dryWet;
+      for (auto i = 0U; i < numSamples; ++i)
+      {
+        out_l[i] = out_l[i] * wet + in_l[i] * dry;
+        out_r[i] = out_r[i] * wet + in_r[i] * dry;
+      }
+    }
+
+    void setParameter(const AudioProcessor::Parameter& param) override
+    {
+      PreparedParameter prepared;
+      if (prepareParameter(param, prepared))
+      {
+        applyParameter(prepared);
+        return;
+      }
+
+      switch (param.index)
+      {
+        case Mode:
+          if (m_vocoder != (param.value < 0.5))
+          {
+            m_vocoder = param.value < 0.5;
+            reset();
+          }
+          break;
+        case DryWet:
+          m_dryWet = param.value;
+          break;
+        default:
+          break;
+      }
+    }
+
+    bool prepareParameter(const AudioProcessor::Parameter& param, PreparedParameter& prepared) const override
+    {
+      prepared.index = param.index;
+      switch (param.index)
+      {
+        case Bandwidth:
+          prepared.set(MaxQuality * std::pow(MinQuality / MaxQuality, param.value));
+          return true;
+        case Attack:
+          prepared.set(timeToCoefficient(MinAttack * std::pow(MaxAttack / MinAttack, param.value), m_fs));
+          return true;
+        case Release:
+          prepared.set(timeToCoefficient(MinRelease * std::pow(MaxRelease / MinRelease, param.value), m_fs));
+          return true;
+        case Threshold:
+          prepared.set(std::pow(10.0f, MinThresholdDb * (1 - param.value) / 20));
+          return true;
+        case Output:
+          prepared.set(std::pow(10.0f, (param.value - 0.5f) * 2 * MaxOutputDb / 20));
+          return true;
+        default:
+          return false;
+      }
+    }
+
+    void applyParameter(const PreparedParameter& prepared) override
+    {
+      const auto value = prepared.get<float>();
+      switch (prepared.index)
+      {
+        case Bandwidth:
+          // Unity peak band passes overlap and sum to about pi / (2 Q spacing)
+          m_left.setResonance(value);
+          m_right.setResonance(value);
+          m_normalise = 2 * value * m_spacing / M_PI;
+          break;
+        case Attack:
+          m_attack = broadcast(value);
+          break;
+        case Release:
+          m_release = broadcast(value);
+          break;
+        case Threshold:
+          m_threshold = broadcast(value);
+          break;
+        case Output:
+          m_output = value;
+          break;
+        default:
+          break;
+      }
+    }
+
+  private:
+    void vocode(const Sample* modulator, const Sample* carrier, Sample* out_l, Sample* out_r, std::size_t numSamples)
+    {
+      Vec4 modulatorBands[Bank::Groups];
+      Vec4 carrierBands[Bank::Groups];
+
+      for (auto i = 0U; i < numSamples; ++i)
+      {
+        m_left.bandpass(modulator[i], modulatorBands);
+        m_right.bandpass(carrier[i], carrierBands);
+
+        Vec4 acc{};
+        for (auto g = 0U; g < Bank::Groups; ++g)
+        {
+          auto& envelope = m_envelopes[g];
+          const auto level = abs(modulatorBands[g]);
+          envelope += (level > envelope ? m_attack : m_release) * (level - envelope);
+          acc += envelope * carrierBands[g];
+        }
+
+        out_l[i] = out_r[i] = VocoderMakeup * m_normalise * sum(acc);
+      }
+    }
+
+    void gate(const Sample* in_l, const Sample* in_r, Sample* out_l, Sample* out_r, std::size_t numSamples)
+    {
+      Vec4 bands_l[Bank::Groups];
+      Vec4 bands_r[Bank::Groups];
+      const auto open = broadcast(1);
+      const auto closed = broadcast(0);
+
+      for (auto i = 0U; i < numSamples; ++i)
+      {
+        m_left.bandpass(in_l[i], bands_l);
+        m_right.bandpass(in_r[i], bands_r);
+
+        Vec4 acc_l{};
+        Vec4 acc_r{};
+        for (auto g = 0U; g < Bank::Groups; ++g)
+        {
+          auto& envelope = m_envelopes[g];
+          auto level = abs(bands_l[g]);
+          level = abs(bands_r[g]) > level ? abs(bands_r[g]) : level;
+          envelope += (level > envelope ? m_attack : m_release) * (level - envelope);
+
+          auto& gain = m_gains[g];
+          gain += m_gateCoefficient * ((envelope > m_threshold ? open : closed) - gain);
+
+          acc_l += gain * bands_l[g];
+          acc_r += gain * bands_r[g];
+        }
+
+        out_l[i] = m_normalise * sum(acc_l);
+        out_r[i] = m_normalise * sum(acc_r);
+      }
+    }
+
+    void reset()
+    {
+      m_left.reset();
+      m_right.reset();
+      m_envelopes.fill(Vec4{});
+      m_gains.fill(broadcast(1));
+    }
+
+    std::uint32_t m_fs;
+    bool m_vocoder = true;
+    float m_dryWet = 1;
+    float m_output = 1;
+    float m_spacing = 0;
+    float m_normalise = 1;
+    Bank m_left;
+    Bank m_right;
+    std::array<Vec4, Bank::Groups> m_envelopes{};
+    std::array<Vec4, Bank::Groups> m_gains{};
+    Vec4 m_attack{};
+    Vec4 m_release{};
+    Vec4 m_threshold{};
+    Vec4 m_gateCoefficient;
+};
+
+class FilterBankPlugin : public FxPlugin
+{
+  public:
+    FxPluginInfo getPluginInfo() const override
+    {
+      return {"Filter Bank", {"Mode", "Bandwidth", "Attack", "Release", "Threshold", "Output", "Dry/Wet"}};
+    }
+
+    AudioProcessor::Ptr createAudioProcessor(const AudioProcessingContext& context) const override
+    {
+      return std::make_unique<FilterBank>(context);
+    }
+};
+
+}
+
+using namespace awesomefx;
+
+extern "C" FxPlugin::Ptr createFxPlugin()
+{
+  return std::make_unique<FilterBankPlugin>();
+}
@@ -0,0 +1,203 @@
+#include <audio_processor.h>
+#include <fx_plugin.h>
+#include <delay_line.h>
+#include <one_pole.h>
+#include <sliding_window.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <memory>
+
+namespace awesomefx
+{
+
+namespace
+{
+const std::uint32_t Input = 0;
+const std::uint32_t Ceiling = 1;
+const std::uint32_t Release = 2;
+
+const float Lookahead = 0.005;
+const float MaxInputDb = 24;
+const float MinCeilingDb = -24;
+const float MinRelease = 0.01;
+const float MaxRelease = 1;
+
+// Input gain changes are smoothed so they do not click
+const float InputSmoothing = 20;
+
+// Holds the lookahead at 5 ms up to 384 kHz
+const std::size_t WindowCapacity = 2048;
+
+using DelayLine = dsp::DelayLine<WindowCapacity>;
+
+inline float dbToGain(float db)
+{
+  return std::pow(10.0f, db / 20);
+}
+}
+
+// Brickwall lookahead limiter. The gain needed for the loudest sample in the
+// lookahead window is held over the window, released exponentially and then
+// smoothed by two moving averages that together span the window, so the gain
+// reaches its target along an S curve just as the peak leaves the delay.
+// Both channels share the gain.
+class Limiter : public AudioProcessor
+{
+  public:
+    Limiter(const AudioProcessingContext& context)
+      : m_fs(context.getSampleRate())
+      , m_lookahead(std::min<std::size_t>(std::lround(Lookahead * m_fs), WindowCapacity - 1))
+    {
+      // The averages span lookahead + 1 samples between them, which is what
+      // the peak hold covers
+      m_peak.setLength(m_lookahead + 1);
+      m_smooth1.setLength(m_lookahead / 2 + 1, 1);
+      m_smooth2.setLength(m_lookahead - m_lookahead / 2 + 1, 1);
+      m_input.setCutoff(InputSmoothing, m_fs);
+
+      setParameter({Input, 0});
+      setParameter({Ceiling, 1});
+      setParameter({Release, 0.5});
+      m_input.reset(m_inputTarget);
+    }
+
+    void process(Sample* in_l, Sample* in_r, Sample* out_l, Sample* out_r, std::size_t numSamples) override
+    {
+      const Sample* in[] = { in_l, in_r };
+      Sample* out[] = { out_l, out_r };
+      run<2>(in, out, numSamples);
+    }
+
+    bool preservesMono() const override
+    {
+      return true;
+    }
+
+    void processMono(Sample* in, Sample* out, std::size_t numSamples) override
+    {
+      const Sample* ins[] = { in };
+      Sample* outs[] = { out };
+      run<1>(ins, outs, numSamples);
+    }
+
+    void leaveMono() override
+    {
+      m_delays[1] = m_delays[0];
+    }
+
+    std::uint32_t getLatency() const override
+    {
+      return m_lookahead;
+    }
+
+    void setParameter(const AudioProcessor::Parameter& param) override
+    {
+      PreparedParameter prepared;
+      if (prepareParameter(param, prepared))
+      {
+        applyParameter(prepared);
+      }
+    }
+
+    bool prepareParameter(const AudioProcessor::Parameter& param, PreparedParameter& prepared) const override
+    {
+      prepared.index = param.index;
+      switch (param.index)
+      {
+        case Input:
+          prepared.set(dbToGain(param.value * MaxInputDb));
+          return true;
+        case Ceiling:
+          prepared.set(dbToGain(MinCeilingDb * (1 - param.value)));
+          return true;
+        case Release:
+          prepared.set(1 - std::exp(-1 / (MinRelease * std::pow(MaxRelease / MinRelease, param.value) * m_fs)));
+          return true;
+        default:
+          return false;
+      }
+    }
+
+    void applyParameter(const PreparedParameter& prepared) override
+    {
+      const auto value = prepared.get<float>();
+      switch (prepared.index)
+      {
+        case Input:
+          m_inputTarget = value;
+          break;
+        case Ceiling:
+          m_ceiling = value;
+          break;
+        case Release:
+          m_release = value;
+          break;
+        default:
+          break;
+      }
+    }
+
+  private:
+    template<std::size_t Channels>
+    void run(const Sample* const* in, Sample* const* out, std::size_t numSamples)
+    {
+      for (auto i = 0U; i < numSamples; ++i)
+      {
+        const auto input = m_input.process(m_inputTarget);
+
+        Sample peak = 0;
+        for (auto c = 0U; c < Channels; ++c)
+        {
+          const auto x = in[c][i] * input;
+          m_delays[c].write(x);
+          peak = std::max(peak, std::abs(x));
+        }
+
+        const auto held = m_peak.process(peak);
+        const auto target = held > m_ceiling ? m_ceiling / held : 1.0f;
+        m_gain = target < m_gain ? target : m_gain + m_release * (target - m_gain);
+        const auto gain = m_smooth2.process(m_smooth1.process(m_gain));
+
+        for (auto c = 0U; c < Channels; ++c)
+        {
+          out[c][i] = m_delays[c].tap(m_lookahead + 1) * gain;
+        }
+      }
+    }
+
+    std::uint32_t m_fs;
+    std::uint32_t m_lookahead;
+    dsp::SlidingMax<WindowCapacity> m_peak;
+    dsp::MovingAverage<WindowCapacity> m_smooth1;
+    dsp::MovingAverage<WindowCapacity> m_smooth2;
+    std::array<DelayLine, 2> m_delays;
+    dsp::OnePole m_input;
+    float m_inputTarget = 1;
+    float m_ceiling = 1;
+    float m_release = 0;
+    float m_gain = 1;
+};
+
+class LimiterPlugin : public FxPlugin
+{
+  public:
+    FxPluginInfo getPluginInfo() const override
+    {
+      return {"Limiter", {"Input", "Ceiling", "Release"}};
+    }
+
+    AudioProcessor::Ptr createAudioProcessor(const AudioProcessingContext& context) const override
+    {
+      return std::make_unique<Limiter>(context);
+    }
+};
+
+}
+
+using namespace awesomefx;
+
+extern "C" FxPlugin::Ptr createFxPlugin()
+{
+  return std::make_unique<LimiterPlugin>();
+}
@@ -1,7 +1,7 @@
 #include <audio_processor.h>
 #include <fx_plugin.h>
+#include <oscillator.h>
 #include <memory>
-#include <cmath>
 
 namespace
 {
@@ -18,16 +18,15 @@ class SimplePanner : public AudioProcessor
     SimplePanner(const AudioProcessingContext& context)
     {
       m_fs = context.getSampleRate();
-      m_t = 0;
       m_params = {0.5, 0.0};
+      m_lfo.setFrequency(10.0f * m_params[Sweep], m_fs);
     }
 
     void process(Sample* in_l, Sample* in_r, Sample* out_l, Sample* out_r, std::size_t numSamples) override
     {
       while (numSamples--)
       {
-        auto pan = 0.5 + m_params[Depth] * 0.5 * std::sin(2 * 3.141592 * m_params[Sweep] * m_t);
-        m_t += 10.0 / m_fs;
+        auto pan = 0.5f + m_params[Depth] * 0.5f * m_lfo.next();
         *out_l++ = (1 - pan) * *in_l++;
         *out_r++ = pan * *in_r++;
       }
@@ -36,10 +35,15 @@ class SimplePanner : public AudioProcessor
     void setParameter(const AudioProcessor::Parameter& param) override
     {
       m_params[param.index] = param.value;
+
+      if (param.index == Sweep)
+      {
+        m_lfo.setFrequency(10.0f * param.value, m_fs);
+      }
     }
 
     std::uint32_t m_fs;
-    float m_t;
+    dsp::ControlRateLfo<> m_lfo;
     std::vector<float> m_params;
 };
 
@@ -20,6 +20,16 @@ class Passthrough : public AudioProcessor
       std::memcpy(out_r, in_r, sizeof(Sample) * numSamples);
     }
 
+    bool preservesMono() const override
+    {
+      return true;
+    }
+
+    void processMono(Sample* in, Sample* out, std::size_t numSamples) override
+    {
+      std::memcpy(out, in, sizeof(Sample) * numSamples);
+    }
+
     void setParameter(const AudioProcessor::Parameter& param) override
     {
     }
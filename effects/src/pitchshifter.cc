@@ -1,5 +1,6 @@
 #include <audio_processor.h>
 #include <fx_plugin.h>
+#include <delay_line.h>
 #include <memory>
 #include <cmath>
 
@@ -12,15 +13,7 @@ namespace
   const int Pitch = 0;
   const int DryWet = 1;
 
-  inline Sample interpolate(float phase, const std::vector<Sample>& delayLine)
-  {
-    int i = phase;
-    float f = phase - i;
-    auto first = delayLine[i];
-    if (++i >= DelayLineSize) i = 0;
-    auto second = delayLine[i];
-    return first + (second - first) * f;
-  }
+  using DelayLine = dsp::DelayLine<DelayLineSize, dsp::Interpolation::Linear>;
 }
 
 class PitchShifter : public AudioProcessor
@@ -28,40 +21,27 @@ class PitchShifter : public AudioProcessor
   public:
     PitchShifter(const AudioProcessingContext& context)
     {
-      m_lDelayLine.reserve(DelayLineSize);
-      m_rDelayLine.reserve(DelayLineSize);
-      std::fill(m_lDelayLine.begin(), m_lDelayLine.end(), 0);
-      std::fill(m_rDelayLine.begin(), m_rDelayLine.end(), 0);
     }
 
     void process(Sample* in_l, Sample* in_r, Sample* out_l, Sample* out_r, std::size_t numSamples) override
     {
-      while (numSamples--)
-      {
-        auto left = *in_l++;
-        auto right = *in_r++;
-
-        m_index++;
-        if (m_index >= DelayLineSize) m_index = 0;
-        m_lDelayLine[m_index] = left;
-        m_rDelayLine[m_index] = right;
-
-        auto phase = m_phase * DelayLineSize;
-        auto read2 = phase + 0.5 * DelayLineSize;
-        if (read2 >= DelayLineSize) read2 -= DelayLineSize;
+      run(m_lDelayLine, in_l, out_l, numSamples);
+      m_phase = run(m_rDelayLine, in_r, out_r, numSamples);
+    }
 
-        auto fade = 2.0 * (m_phase >= 0.5 ? 1.0 - m_phase : m_phase);
+    bool preservesMono() const override
+    {
+      return true;
+    }
 
-        auto wet_l = interpolate(phase, m_lDelayLine) * fade + interpolate(read2, m_lDelayLine) * (1 - fade);
-        auto wet_r = interpolate(phase, m_rDelayLine) * fade + interpolate(read2, m_rDelayLine) * (1 - fade);
-        auto wetness = m_params[DryWet];
-        *out_l++ = wet_l * wetness + left * (1 - wetness);
-        *out_r++ = wet_r * wetness + right * (1 - wetness);
+    void processMono(Sample* in, Sample* out, std::size_t numSamples) override
+    {
+      m_phase = run(m_lDelayLine, in, out, numSamples);
+    }
 
-        m_phase += 2 * m_params[Pitch] / DelayLineSize;
-        if (m_phase >= 1.0) m_phase -= 1.0;
-        if (m_phase <= 0.0) m_phase += 1.0;
-      }
+    void leaveMono() override
+    {
+      m_rDelayLine = m_lDelayLine;
     }
 
     void setParameter(const AudioProcessor::Parameter& param) override
@@ -69,10 +49,38 @@ class PitchShifter : public AudioProcessor
       m_params[param.index] = param.value;
     }
 
+  private:
+    // Runs one channel from the current phase, returns the phase it ends at
+    float run(DelayLine& delayLine, const Sample* in, Sample* out, std::size_t numSamples) const
+    {
+      auto phase = m_phase;
+      while (numSamples--)
+      {
+        auto dry = *in++;
+        delayLine.write(dry);
+
+        // Two read heads half a buffer apart, each faded out where its delay wraps
+        auto delay1 = phase * DelayLineSize;
+        auto delay2 = delay1 + 0.5f * DelayLineSize;
+        if (delay2 >= DelayLineSize) delay2 -= DelayLineSize;
+
+        auto fade = 2.0 * (phase >= 0.5 ? 1.0 - phase : phase);
+
+        auto wet = delayLine.read(delay1) * fade + delayLine.read(delay2) * (1 - fade);
+        auto wetness = m_params[DryWet];
+        *out++ = wet * wetness + dry * (1 - wetness);
+
+        // A shrinking delay reads faster than it is written, Pitch 0.5 is unity
+        phase += (1 - 2 * m_params[Pitch]) / DelayLineSize;
+        if (phase >= 1.0) phase -= 1.0;
+        if (phase <= 0.0) phase += 1.0;
+      }
+      return phase;
+    }
+
     std::vector<float> m_params {0.5, 0.0};
-    std::vector<Sample> m_lDelayLine;
-    std::vector<Sample> m_rDelayLine;
-    std::uint32_t m_index = 0;
+    DelayLine m_lDelayLine;
+    DelayLine m_rDelayLine;
     float m_phase = 0;
 };
 
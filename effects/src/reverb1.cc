@@ -1,5 +1,9 @@
 #include <audio_processor.h>
 #include <fx_plugin.h>
+#include <allpass.h>
+#include <comb_bank.h>
+#include <array>
+#include <algorithm>
 #include <memory>
 #include <cmath>
 
@@ -13,61 +17,16 @@ const int DryWet = 1;
 
 const int AllpassBufferSize = 2048 * 2;
 const int CombBufferSize = 16384 * 2;
+const std::size_t BlockSize = 64;
+const float StereoSpread = 31;
 
-class Allpass
-{
-  public:
-    Allpass(float gain)
-      : m_gain(gain)
-    {
-      m_buffer.resize(AllpassBufferSize);
-    }
-
-    inline Sample filter(Sample in, float delay)
-    {
-      auto m = m_index - delay;
-      if (m < 0) m += AllpassBufferSize;
-
-      auto y = m_buffer[m] - m_gain * in;
-      m_buffer[m_index++] = in + y * m_gain;
-      if (m_index >= AllpassBufferSize) m_index = 0;
-
-      return y;
-    }
-
-  private:
-    std::vector<Sample> m_buffer;
-    int m_index = 0;
-    float m_gain;
-};
-
-class FbComb
-{
-  public:
-    FbComb(float gain)
-      : m_gain(gain)
-    {
-      m_buffer.resize(CombBufferSize);
-    }
-
-    inline Sample filter(Sample in, float delay)
-    {
-      auto m = m_index - delay;
-      if (m < 0) m += CombBufferSize;
-
-      auto y = m_buffer[m];
-
-      auto out = m_buffer[m_index++] = in + m_gain * y;
-      if (m_index >= CombBufferSize) m_index = 0;
-
-      return out;
-    }
+using Allpass = dsp::Allpass<AllpassBufferSize>;
+using CombBank = dsp::FeedbackCombBank<CombBufferSize>;
 
-  private:
-    std::vector<Sample> m_buffer;
-    int m_index = 0;
-    float m_gain;
-};
+std::uint32_t toDelay(float delay)
+{
+  return static_cast<std::uint32_t>(std::ceil(delay));
+}
 
 }
 
@@ -77,32 +36,55 @@ class FbComb
       Reverb1(const AudioProcessingContext& context)
         : m_fs(context.getSampleRate())
       {
+        updateDelays();
       }
 
       void process(Sample* in_l, Sample* in_r, Sample* out_l, Sample* out_r, std::size_t numSamples) override
       {
-        // Schroeder reverb with 4 parallell comb filters + 3 allpass filters in series
-        while (numSamples--)
+        // Schroeder reverb with 4 parallell comb filters + 3 allpass filters in series.
+        // The left combs run in lanes 0-3 of the bank and the right ones in 4-7.
+        Sample mono[BlockSize];
+        dsp::Vec8 combs[BlockSize];
+        Sample y_l[BlockSize];
+        Sample y_r[BlockSize];
+
+        while (numSamples)
         {
-          Sample y_l = 0, y_r = 0;
-          auto left = *in_l++;
-          auto right = *in_r++;
-          auto in = (left + right) * 0.5;
+          const auto n = std::min(numSamples, BlockSize);
+
+          for (auto i = 0U; i < n; ++i)
+          {
+            mono[i] = (in_l[i] + in_r[i]) * 0.5f;
+          }
+
+          m_combs.process(mono, combs, n);
 
-          for (auto i = 0U; i < m_lFbcf.size(); ++i)
+          for (auto i = 0U; i < n; ++i)
           {
-            y_l += 0.25 * m_lFbcf[i].filter(in, m_combDelays[i] * m_size);
-            y_r += 0.25 * m_rFbcf[i].filter(in, m_combDelays[i] * m_size + 31);
+            const auto& y = combs[i];
+            y_l[i] = 0.25f * ((y[0] + y[1]) + (y[2] + y[3]));
+            y_r[i] = 0.25f * ((y[4] + y[5]) + (y[6] + y[7]));
           }
 
           for (auto i = 0U; i < m_lAps.size(); ++i)
           {
-            y_l = m_lAps[i].filter(y_l, m_apDelays[i] * m_size);
-            y_r = m_rAps[i].filter(y_r, m_apDelays[i] * m_size + 31);
+            m_lAps[i].processFixed(y_l, n, m_lApDelays[i]);
+            m_rAps[i].processFixed(y_r, n, m_rApDelays[i]);
           }
 
-          *out_l++ = y_l * m_dryWet * 0.8 + y_r * m_dryWet * 0.2 + left * (1 - m_dryWet);
-          *out_r++ = y_r * m_dryWet * 0.8 + y_l * m_dryWet * 0.2 + right * (1 - m_dryWet);
+          const auto wet = m_dryWet;
+          const auto dry = 1 - m_dryWet;
+          for (auto i = 0U; i < n; ++i)
+          {
+            out_l[i] = y_l[i] * wet * 0.8f + y_r[i] * wet * 0.2f + in_l[i] * dry;
+            out_r[i] = y_r[i] * wet * 0.8f + y_l[i] * wet * 0.2f + in_r[i] * dry;
+          }
+
+          in_l += n;
+          in_r += n;
+          out_l += n;
+          out_r += n;
+          numSamples -= n;
         }
       }
 
@@ -112,6 +94,7 @@ class FbComb
         {
           case Size:
             m_size = param.value;
+            updateDelays();
             break;
           case DryWet:
             m_dryWet = param.value;
@@ -121,13 +104,32 @@ class FbComb
         }
       }
 
+    private:
+      void updateDelays()
+      {
+        std::array<std::uint32_t, CombBank::Lanes> combDelays;
+        for (auto i = 0U; i < m_combDelays.size(); ++i)
+        {
+          combDelays[i] = toDelay(m_combDelays[i] * m_size);
+          combDelays[i + m_combDelays.size()] = toDelay(m_combDelays[i] * m_size + StereoSpread);
+        }
+        m_combs.setDelays(combDelays);
+
+        for (auto i = 0U; i < m_apDelays.size(); ++i)
+        {
+          m_lApDelays[i] = toDelay(m_apDelays[i] * m_size);
+          m_rApDelays[i] = toDelay(m_apDelays[i] * m_size + StereoSpread);
+        }
+      }
+
       std::uint32_t m_fs;
-      std::vector<Allpass> m_lAps { { 0.7 }, { 0.7}, { 0.7 } };
-      std::vector<Allpass> m_rAps { { 0.7 }, { 0.7}, { 0.7 } };
-      std::vector<float> m_apDelays { 1853.964 * 2, 594.468 * 2, 199.332 * 2 };
-      std::vector<FbComb> m_lFbcf { { 0.742 }, { 0.733 }, { 0.715 }, { 0.697 } };
-      std::vector<FbComb> m_rFbcf { { 0.742 }, { 0.733 }, { 0.715 }, { 0.697 } };
-      std::vector<float> m_combDelays { 8465.436 * 2, 8818.236 * 2, 9523.836 * 2, 10232.964 * 2 };
+      std::array<Allpass, 3> m_lAps { { { 0.7 }, { 0.7}, { 0.7 } } };
+      std::array<Allpass, 3> m_rAps { { { 0.7 }, { 0.7}, { 0.7 } } };
+      std::array<float, 3> m_apDelays { 1853.964 * 2, 594.468 * 2, 199.332 * 2 };
+      std::array<std::uint32_t, 3> m_lApDelays{};
+      std::array<std::uint32_t, 3> m_rApDelays{};
+      CombBank m_combs { { 0.742, 0.733, 0.715, 0.697, 0.742, 0.733, 0.715, 0.697 } };
+      std::array<float, 4> m_combDelays { 8465.436 * 2, 8818.236 * 2, 9523.836 * 2, 10232.964 * 2 };
       float m_size = 0.0;
       float m_dryWet = 0.0;
   };
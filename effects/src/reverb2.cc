@@ -1,8 +1,12 @@
 #include <audio_processor.h>
 #include <fx_plugin.h>
+#include <delay_arena.h>
+#include <one_pole.h>
+#include <oscillator.h>
+#include <algorithm>
+#include <array>
 #include <memory>
 #include <cmath>
-#include <tuple>
 
 namespace awesomefx
 {
@@ -17,111 +21,95 @@ const std::uint32_t ModRate = 4;
 const std::uint32_t ModDepth = 5;
 const std::uint32_t DryWet = 6;
 
-class Allpass
-{
-  public:
-    Allpass(std::uint32_t size, float fb_gain, float ff_gain)
-      : size_(size)
-      , fb_gain_(fb_gain)
-      , ff_gain_(ff_gain)
-    {
-      buffer_.resize(size);
-      std::fill(buffer_.begin(), buffer_.end(), 0);
-    }
+// One modulation value is ramped over each block
+const std::size_t BlockSize = 32;
 
-    inline Sample process(Sample in, float delay)
-    {
-      auto m = index_ - delay;
-      if (m < 0) m += size_;
+// Line lengths below are in samples at 44.1 kHz and are scaled to the
+// running sample rate. The output taps are given at the 29761 Hz of the paper.
+const float LengthRate = 44100;
+const float TapRate = 29761;
 
-      const auto y = buffer_[m] + ff_gain_ * in;
-      buffer_[index_++] = in + fb_gain_ * y;
-      if (index_ >= size_) index_ = 0;
+const float MaxPredelay = 20000;
+const float ModExcursion = 128;
 
-      return y;
-    }
+using LPFilter = dsp::OnePole;
+using Line = dsp::DelayArena::Line;
 
-    inline Sample tap(std::uint32_t index) const
-    {
-      std::int32_t m = index_ - index;
-      if (m < 0) m += size_;
-      return buffer_[m];
-    }
-
-    inline std::uint32_t size() const
-    {
-      return size_;
-    }
-
-  private:
-    std::vector<Sample> buffer_{};
-    std::uint32_t index_{};
-    std::uint32_t size_{};
-    float fb_gain_{};
-    float ff_gain_{};
-};
-
-class LPFilter
+inline std::uint32_t scale(float length, float ratio)
 {
-  public:
-    inline void setGain(float gain, float fb_gain)
-    {
-      gain_ = gain;
-      fb_gain_ = fb_gain;
-    }
-
-    inline Sample process(Sample input)
-    {
-      return x1_ = gain_ * input + fb_gain_ * x1_;
-    }
+  return static_cast<std::uint32_t>(length * ratio + 0.5f);
+}
 
-  private:
-    Sample x1_{};
-    float gain_{};
-    float fb_gain_{};
-};
+inline Sample allpass(dsp::DelayArena& arena, const Line& line, std::uint32_t readOffset, Sample in, float fb_gain, float ff_gain)
+{
+  const auto y = arena.read(readOffset) + ff_gain * in;
+  arena.write(line.base, in + fb_gain * y);
+  return y;
+}
 
-class Delay
+class ReverbTank
 {
   public:
-    Delay(std::uint32_t size)
-      : size_(size)
-    {
-      buffer_.resize(size);
-      std::fill(buffer_.begin(), buffer_.end(), 0);
-    }
-
-    inline Sample read(float delay) const
+    ReverbTank(std::uint32_t fs)
+      : lengthRatio_(fs / LengthRate)
+      , fs_(fs)
     {
-      auto m = index_ - delay;
-      if (m < 0) m += size_;
+      auto& left = sides_[0];
+      auto& right = sides_[1];
 
-      return buffer_[m];
-    }
+      left.diffusion1Center = scale(995, lengthRatio_) - 1.0f;
+      right.diffusion1Center = scale(1345, lengthRatio_) - 1.0f;
 
-    inline void write(Sample in)
-    {
-      buffer_[index_++] = in;
-      if (index_ >= size_) index_ = 0;
-    }
+      const auto excursion = scale(ModExcursion, lengthRatio_);
+      left.diffusion1 = arena_.reserve(static_cast<std::uint32_t>(left.diffusion1Center) + excursion + 2);
+      right.diffusion1 = arena_.reserve(static_cast<std::uint32_t>(right.diffusion1Center) + excursion + 2);
 
-    inline std::uint32_t size() const
-    {
-      return size_;
-    }
+      const std::array<std::array<std::uint32_t, 3>, 2> lengths{ { { 2667, 6598, 5512 }, { 3935, 6248, 4687 } } };
+      for (auto i = 0U; i < sides_.size(); ++i)
+      {
+        auto& side = sides_[i];
+        side.diffusion2 = arena_.reserve(scale(lengths[i][0], lengthRatio_));
+        side.delay1 = arena_.reserve(scale(lengths[i][1], lengthRatio_));
+        side.delay2 = arena_.reserve(scale(lengths[i][2], lengthRatio_));
 
-  private:
-    std::vector<Sample> buffer_;
-    std::uint32_t size_{};
-    std::uint32_t index_{};
-};
+        side.diffusion2Read = side.diffusion2.at(side.diffusion2.length - 1);
+        side.delay1Read = side.delay1.at(side.delay1.length - 2);
+      }
 
-class ReverbTank
-{
-  public:
-    ReverbTank(std::uint32_t fs)
-      : fs_(fs)
-    {
+      // The left delay 2 has already been written when the right side reads it
+      left.delay2Read = left.delay2.at(left.delay2.length - 2);
+      right.delay2Read = right.delay2.at(right.delay2.length - 1);
+
+      // Taps are read after the whole tank has been written for the sample
+      const auto tapRatio = fs / TapRate;
+      auto delayTap = [tapRatio](const Line& line, float tap) {
+        return line.at(static_cast<std::uint32_t>(std::ceil(tap * tapRatio)) - 1);
+      };
+      auto allpassTap = [tapRatio](const Line& line, float tap) {
+        return line.at(static_cast<std::uint32_t>(tap * tapRatio) - 1);
+      };
+
+      tapsLeft_ = { {
+        { delayTap(right.delay1, 266), 0.6 },
+        { delayTap(right.delay1, 2974), 0.6 },
+        { allpassTap(right.diffusion2, 1913), -0.6 },
+        { delayTap(right.delay2, 1996), 0.6 },
+        { delayTap(left.delay1, 1990), -0.6 },
+        { allpassTap(left.diffusion2, 187), -0.6 },
+        { delayTap(left.delay2, 1066), -0.6 },
+      } };
+
+      tapsRight_ = { {
+        { delayTap(left.delay1, 353), 0.6 },
+        { delayTap(left.delay1, 3627), 0.6 },
+        { allpassTap(left.diffusion2, 1228), -0.6 },
+        { delayTap(left.delay2, 2673), 0.6 },
+        { delayTap(right.delay2, 2111), -0.6 },
+        { allpassTap(right.diffusion2, 335), -0.6 },
+        { delayTap(right.delay2, 121), -0.6 },
+      } };
+
+      arena_.allocate();
     }
 
     inline void setDecay(float decay)
@@ -131,84 +119,97 @@ class ReverbTank
 
     inline void setDamping(float damping)
     {
-      damping_left_.setGain(1 - damping, damping);
-      damping_right_.setGain(1 - damping, damping);
+      for (auto& side : sides_)
+      {
+        side.damping.setCoefficients(1 - damping, damping);
+      }
     }
 
     inline void setModRate(float rate)
     {
-      modStep_ = 3 * rate;
+      mod_lfo_.setFrequency(3 * rate, fs_);
     }
 
     inline void setModDepth(float depth)
     {
-      modDepth_ = depth;
+      modDepth_ = depth * ModExcursion * lengthRatio_;
     }
 
-    inline std::tuple<Sample, Sample> process(Sample input)
+    // At most BlockSize samples
+    void process(const Sample* input, Sample* out_l, Sample* out_r, std::size_t numSamples)
     {
-      Sample out_l = 0.0;
-      Sample out_r = 0.0;
-
-      const auto mod = std::sin(2 * 3.141592 * modPhase_ / fs_) * 128.0 * modDepth_;
-      modPhase_ += modStep_;
-
-      auto tank1 = decay_diffusion_1_left_.process(input, Diffusion1BaseDelayLeft - 1.0 + mod) + decay_ * delay_2_right_.read(delay_2_right_.size() - 1);
-      delay_1_left_.write(tank1);
-      tank1 = delay_1_left_.read(delay_1_left_.size() - 1);
-      tank1 = damping_left_.process(tank1);
-      tank1 = decay_diffusion_2_left_.process(tank1 * decay_, decay_diffusion_2_left_.size() - 1);
-      delay_2_left_.write(tank1);
-
-      auto tank2 = decay_diffusion_1_right_.process(input, Diffusion1BaseDelayRight - 1.0 + mod) + decay_ * delay_2_left_.read(delay_2_left_.size() - 1);
-      delay_1_right_.write(tank2);
-      tank2 = delay_1_right_.read(delay_1_right_.size() - 1);
-      tank2 = damping_right_.process(tank2);
-      tank2 = decay_diffusion_2_right_.process(tank2 * decay_, decay_diffusion_2_right_.size() - 1);
-      delay_2_right_.write(tank2);
-
-      const float ratio = fs_ / 29761.0;
-      out_l += 0.6 * delay_1_right_.read(266 * ratio);
-      out_l += 0.6 * delay_1_right_.read(2974 * ratio);
-      out_l -= 0.6 * decay_diffusion_2_right_.tap(1913 * ratio);
-      out_l += 0.6 * delay_2_right_.read(1996 * ratio);
-      out_l -= 0.6 * delay_1_left_.read(1990 * ratio);
-      out_l -= 0.6 * decay_diffusion_2_left_.tap(187 * ratio);
-      out_l -= 0.6 * delay_2_left_.read(1066 * ratio);
-
-      out_r += 0.6 * delay_1_left_.read(353 * ratio);
-      out_r += 0.6 * delay_1_left_.read(3627 * ratio);
-      out_r -= 0.6 * decay_diffusion_2_left_.tap(1228 * ratio);
-      out_r += 0.6 * delay_2_left_.read(2673 * ratio);
-      out_r -= 0.6 * delay_2_right_.read(2111 * ratio);
-      out_r -= 0.6 * decay_diffusion_2_right_.tap(335 * ratio);
-      out_r -= 0.6 * delay_2_right_.read(121 * ratio);
-
-      return {out_l, out_r};
+      float mod[BlockSize];
+      mod_lfo_.process(mod, numSamples);
+
+      auto& left = sides_[0];
+      auto& right = sides_[1];
+
+      for (auto i = 0U; i < numSamples; ++i)
+      {
+        arena_.advance();
+
+        const auto modulation = mod[i] * modDepth_;
+        const auto tank1 = processSide(left, input[i], modulation, arena_.read(right.delay2Read));
+        arena_.write(left.delay2.base, tank1);
+
+        const auto tank2 = processSide(right, input[i], modulation, arena_.read(left.delay2Read));
+        arena_.write(right.delay2.base, tank2);
+
+        out_l[i] = sumTaps(tapsLeft_);
+        out_r[i] = sumTaps(tapsRight_);
+      }
     }
 
   private:
-    // left side of tank
-    const std::uint32_t Diffusion1BaseDelayLeft = 995;
-    Allpass decay_diffusion_1_left_{ Diffusion1BaseDelayLeft + 128, 0.7, -0.7 };
-    Allpass decay_diffusion_2_left_{ 2667, -0.5, 0.5 };
-    Delay delay_1_left_{ 6598 };
-    LPFilter damping_left_{};
-    Delay delay_2_left_{ 5512 };
-
-    // right side of tank
-    const std::uint32_t Diffusion1BaseDelayRight = 1345;
-    Allpass decay_diffusion_1_right_{ Diffusion1BaseDelayRight + 128, 0.7, -0.7 };
-    Allpass decay_diffusion_2_right_{ 3935, -0.5, 0.5 };
-    Delay delay_1_right_{ 6248 };
-    LPFilter damping_right_{};
-    Delay delay_2_right_{ 4687 };
+    struct Tap
+    {
+      std::uint32_t offset;
+      float gain;
+    };
+
+    // Everything one side of the figure-eight touches per sample
+    struct Side
+    {
+      Line diffusion1;
+      Line diffusion2;
+      Line delay1;
+      Line delay2;
+      float diffusion1Center;
+      std::uint32_t diffusion2Read;
+      std::uint32_t delay1Read;
+      std::uint32_t delay2Read;
+      LPFilter damping;
+    };
+
+    inline Sample processSide(Side& side, Sample input, float modulation, Sample feedback)
+    {
+      const auto diffusion1Delay = static_cast<std::uint32_t>(std::ceil(side.diffusion1Center + modulation));
+      auto tank = allpass(arena_, side.diffusion1, side.diffusion1.at(diffusion1Delay), input, 0.7, -0.7) + decay_ * feedback;
+      arena_.write(side.delay1.base, tank);
+      tank = arena_.read(side.delay1Read);
+      tank = side.damping.process(tank);
+      return allpass(arena_, side.diffusion2, side.diffusion2Read, tank * decay_, -0.5, 0.5);
+    }
+
+    inline Sample sumTaps(const std::array<Tap, 7>& taps) const
+    {
+      Sample out = 0;
+      for (const auto& tap : taps)
+      {
+        out += tap.gain * arena_.read(tap.offset);
+      }
+      return out;
+    }
 
+    dsp::DelayArena arena_{};
+    std::array<Side, 2> sides_{};
+    std::array<Tap, 7> tapsLeft_{};
+    std::array<Tap, 7> tapsRight_{};
     float decay_{};
-    std::uint32_t fs_;
-    float modPhase_{};
-    float modStep_{};
+    float lengthRatio_{};
     float modDepth_{};
+    std::uint32_t fs_{};
+    dsp::ControlRateLfo<BlockSize> mod_lfo_{};
 };
 
 }
@@ -218,9 +219,21 @@ class ReverbTank
     public:
       Reverb2(const AudioProcessingContext& context)
         : fs_(context.getSampleRate())
+        , lengthRatio_(fs_ / LengthRate)
       {
-        predelay_time_ = 5000;
-        predelay_filter_.setGain(0.9995, 1 - 0.9995);
+        predelay_ = arena_.reserve(scale(MaxPredelay, lengthRatio_) + 1);
+
+        const std::array<float, 4> lengths{ 210, 148, 561, 410 };
+        for (auto i = 0U; i < lengths.size(); ++i)
+        {
+          input_diffusion_[i] = arena_.reserve(scale(lengths[i], lengthRatio_));
+          input_diffusion_reads_[i] = input_diffusion_[i].at(input_diffusion_[i].length - 1);
+        }
+
+        arena_.allocate();
+
+        setPredelay(0.25);
+        predelay_filter_.setCoefficients(0.9995, 1 - 0.9995);
         reverbTank_.setDecay(0.5);
         reverbTank_.setDamping(0.0005);
       }
@@ -228,30 +241,47 @@ class ReverbTank
       void process(Sample* in_l, Sample* in_r, Sample* out_l, Sample* out_r, std::size_t numSamples) override
       {
         // Plate-class reverb from J. Dattorro, Effect Design Part 1: Reverberator and Other Filters
-        while (numSamples--)
+        Sample diffused[BlockSize];
+        Sample wet_l[BlockSize];
+        Sample wet_r[BlockSize];
+
+        while (numSamples)
         {
-          const auto left = *in_l++;
-          const auto right = *in_r++;
+          const auto n = std::min(numSamples, BlockSize);
+
+          for (auto i = 0U; i < n; ++i)
+          {
+            arena_.advance();
 
-          const auto in = 0.5 * (left + right);
+            // Predelay + low pass filter
+            arena_.write(predelay_.base, 0.5f * (in_l[i] + in_r[i]));
+            auto sample = predelay_filter_.process(arena_.read(predelay_read_));
 
-          // Predelay + low pass filter
-          predelay_.write(in);
-          auto predelayed = predelay_.read(predelay_time_);
-          predelayed = predelay_filter_.process(predelayed);
+            // Input Diffusers
+            for (auto k = 0U; k < input_diffusion_.size(); ++k)
+            {
+              sample = allpass(arena_, input_diffusion_[k], input_diffusion_reads_[k], sample, DiffusionGains[k], -DiffusionGains[k]);
+            }
 
-          // Input Diffusers
-          auto diffused = predelayed;
-          for (auto& ap : input_diffusion_aps_)
-          {
-            diffused = ap.process(diffused, ap.size() - 1);
+            diffused[i] = sample;
           }
 
           // Tank
-          const auto wet = reverbTank_.process(diffused);
+          reverbTank_.process(diffused, wet_l, wet_r, n);
+
+          const auto wet = dryWet_;
+          const auto dry = 1 - dryWet_;
+          for (auto i = 0U; i < n; ++i)
+          {
+            out_l[i] = wet_l[i] * wet + in_l[i] * dry;
+            out_r[i] = wet_r[i] * wet + in_r[i] * dry;
+          }
 
-          *out_l++ = std::get<0>(wet) * dryWet_ + left * (1 - dryWet_);
-          *out_r++ = std::get<1>(wet) * dryWet_ + right * (1 - dryWet_);
+          in_l += n;
+          in_r += n;
+          out_l += n;
+          out_r += n;
+          numSamples -= n;
         }
       }
 
@@ -260,10 +290,10 @@ class ReverbTank
         switch (param.index)
         {
           case PredelayTime:
-            predelay_time_ = 20000 * param.value;
+            setPredelay(param.value);
             break;
           case InputBandwidth:
-            predelay_filter_.setGain(param.value, 1 - param.value);
+            predelay_filter_.setCoefficients(param.value, 1 - param.value);
             break;
           case Decay:
             reverbTank_.setDecay(param.value);
@@ -285,12 +315,25 @@ class ReverbTank
         }
       }
 
+    private:
+      static constexpr std::array<float, 4> DiffusionGains{ -0.75, -0.75, -0.625, -0.625 };
+
+      void setPredelay(float value)
+      {
+        // The predelay line is written before it is read
+        const auto delay = std::ceil(MaxPredelay * value * lengthRatio_) - 1;
+        predelay_read_ = predelay_.at(std::clamp<float>(delay, 0, predelay_.length - 1));
+      }
+
       std::uint32_t fs_;
+      float lengthRatio_;
       float dryWet_{};
-      float predelay_time_{};
-      Delay predelay_{20001};
+      dsp::DelayArena arena_{};
+      Line predelay_{};
+      std::uint32_t predelay_read_{};
       LPFilter predelay_filter_{};
-      std::vector<Allpass> input_diffusion_aps_{ { 210, -0.75, 0.75 }, { 148, -0.75, 0.75  }, { 561, -0.625, 0.625  }, { 410, -0.625, 0.625  } };
+      std::array<Line, 4> input_diffusion_{};
+      std::array<std::uint32_t, 4> input_diffusion_reads_{};
       ReverbTank reverbTank_{fs_};
   };
 
@@ -315,4 +358,3 @@ extern "C" FxPlugin::Ptr createFxPlugin()
 {
   return std::make_unique<Reverb2Plugin>();
 }
-
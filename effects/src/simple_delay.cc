@@ -1,5 +1,6 @@
 #include <audio_processor.h>
 #include <fx_plugin.h>
+#include <algorithm>
 #include <memory>
 #include <cmath>
 
@@ -20,30 +21,29 @@ class SimpleDelay : public AudioProcessor
     SimpleDelay(const AudioProcessingContext& context)
     {
       m_params = {0.2, 0.3, 0.5};
-      m_lBuffer.reserve(DelayBufferSize);
-      m_rBuffer.reserve(DelayBufferSize);
-      std::fill(m_lBuffer.begin(), m_lBuffer.end(), 0.0);
-      std::fill(m_rBuffer.begin(), m_rBuffer.end(), 0.0);
+      m_lBuffer.resize(DelayBufferSize);
+      m_rBuffer.resize(DelayBufferSize);
     }
 
     void process(Sample* in_l, Sample* in_r, Sample* out_l, Sample* out_r, std::size_t numSamples) override
     {
-      while (numSamples--)
-      {
-        if (m_index >= DelayBufferSize) m_index = 0;
-        auto j = m_index - (m_params[Time] * m_maxDelayTime);
-        if (j < 0) j += DelayBufferSize;
+      run(m_lBuffer, in_l, out_l, numSamples);
+      m_index = run(m_rBuffer, in_r, out_r, numSamples);
+    }
 
-        auto dry_l = *in_l++;
-        auto dry_r = *in_r++;
-        m_lBuffer[m_index] = dry_l + (m_lBuffer[j] * m_params[Feedback]);
-        m_rBuffer[m_index] = dry_r + (m_rBuffer[j] * m_params[Feedback]);
-        auto wet_l = m_lBuffer[j] * m_params[Feedback];
-        auto wet_r = m_rBuffer[j] * m_params[Feedback];
-        *out_l++ = m_params[DryWet] * wet_l + (1 - m_params[DryWet]) * dry_l;
-        *out_r++ = m_params[DryWet] * wet_r + (1 - m_params[DryWet]) * dry_r;
-        m_index++;
-      }
+    bool preservesMono() const override
+    {
+      return true;
+    }
+
+    void processMono(Sample* in, Sample* out, std::size_t numSamples) override
+    {
+      m_index = run(m_lBuffer, in, out, numSamples);
+    }
+
+    void leaveMono() override
+    {
+      std::copy(m_lBuffer.begin(), m_lBuffer.end(), m_rBuffer.begin());
     }
 
     void setParameter(const AudioProcessor::Parameter& param) override
@@ -51,6 +51,26 @@ class SimpleDelay : public AudioProcessor
       m_params[param.index] = param.value;
     }
 
+  private:
+    // Runs one channel from the current index, returns the index it ends at
+    int run(std::vector<Sample>& buffer, const Sample* in, Sample* out, std::size_t numSamples) const
+    {
+      auto index = m_index;
+      while (numSamples--)
+      {
+        if (index >= DelayBufferSize) index = 0;
+        auto j = index - (m_params[Time] * m_maxDelayTime);
+        if (j < 0) j += DelayBufferSize;
+
+        auto dry = *in++;
+        buffer[index] = dry + (buffer[j] * m_params[Feedback]);
+        auto wet = buffer[j] * m_params[Feedback];
+        *out++ = m_params[DryWet] * wet + (1 - m_params[DryWet]) * dry;
+        index++;
+      }
+      return index;
+    }
+
     std::vector<float> m_params;
     std::vector<Sample> m_lBuffer;
     std::vector<Sample> m_rBuffer;
@@ -55,6 +55,19 @@ class SimpleDistortion : public AudioProcessor
       }
     }
 
+    bool preservesMono() const override
+    {
+      return true;
+    }
+
+    void processMono(Sample* in, Sample* out, std::size_t numSamples) override
+    {
+      while (numSamples--)
+      {
+        *out++ = distort(*in++, m_params[0]);
+      }
+    }
+
     void setParameter(const AudioProcessor::Parameter& param) override
     {
       m_params[param.index] = param.value;
@@ -1,210 +1,230 @@
 #include <audio_processor.h>
 #include <fx_plugin.h>
+#include <biquad.h>
+#include <simd.h>
+#include <algorithm>
+#include <array>
 #include <memory>
 #include <cmath>
-#include <type_traits>
+#include <string>
+#include <vector>
 
 namespace awesomefx
 {
 
 namespace
 {
-const int Low = 0;
-const int Mid = 1;
-const int High = 2;
+// Every band has these three parameters, band after band
+const std::uint32_t Gain = 0;
+const std::uint32_t Frequency = 1;
+const std::uint32_t Quality = 2;
+const std::uint32_t ParametersPerBand = 3;
 
-const float CutoffLow = 100;
-const float CutoffMid = 1000;
-const float CutoffHigh = 8000;
-const float BandwidthMid = 800;
+// The first band is a low shelf, the last a high shelf, the rest peaks
+const std::size_t Bands = 8;
+const std::array<float, Bands> DefaultFrequencies{ 100, 250, 500, 1000, 2000, 4000, 6000, 8000 };
+const float DefaultQuality = 0.707;
 
-struct LowPass{};
-struct HighPass{};
+const float MaxGainDb = 24;
+const float MinFrequency = 20;
+const float FrequencyRange = 1000;
+const float MinQuality = 0.1;
+const float QualityRange = 100;
 
-template<typename TFilter>
-class ShelvingFilter
+// Coefficient changes are ramped over this many samples
+const std::uint32_t RampSamples = 256;
+
+using Coefficients = dsp::BiquadCoefficients;
+
+struct BandSettings
 {
-  public:
-    ShelvingFilter(std::uint32_t fs, float cutoff)
-      : m_fs(fs),
-        m_cutoff(cutoff)
-    {
-      calcCoeffs();
-    }
+  float gainDb;
+  float frequency;
+  float quality;
+};
+}
 
-    inline void calcCoeffs()
+// Control side half of the EQ, turns parameter values into coefficients
+class EqDesigner
+{
+  public:
+    EqDesigner(std::uint32_t fs)
+      : m_fs(fs)
     {
-      auto tan = std::tan(3.141592 * m_cutoff / m_fs);
-      m_c_b = (tan - 1) / (tan + 1);
-      if (std::is_same<TFilter, LowPass>::value)
-      {
-        m_c_c = (tan - m_v0) / (tan + m_v0);
-      }
-      else
+      for (auto band = 0U; band < Bands; ++band)
       {
-        m_c_c = m_v0 * (tan - 1) / m_v0 * (tan + 1);
+        m_settings[band] = {0, DefaultFrequencies[band], DefaultQuality};
       }
     }
 
-    inline void setGain(float gain)
+    bool prepare(const AudioProcessor::Parameter& param, AudioProcessor::PreparedParameter& prepared) const
     {
-      gain -= 0.5;
-      m_v0 = std::pow(10.0, gain * 48 / 20.0);
-      if (gain >= 0.0)
+      const auto band = param.index / ParametersPerBand;
+      if (band >= Bands)
       {
-        m_c = m_c_b;
+        return false;
       }
-      else
+
+      auto& settings = m_settings[band];
+      switch (param.index % ParametersPerBand)
       {
-        calcCoeffs();
-        m_c = m_c_c;
+        case Gain:
+          settings.gainDb = (param.value - 0.5f) * 2 * MaxGainDb;
+          break;
+        case Frequency:
+          settings.frequency = MinFrequency * std::pow(FrequencyRange, param.value);
+          break;
+        case Quality:
+          settings.quality = MinQuality * std::pow(QualityRange, param.value);
+          break;
       }
+
+      prepared.index = band;
+      prepared.set(design(band));
+      return true;
     }
 
-    inline Sample filter(Sample in)
+    Coefficients design(std::size_t band) const
     {
-      auto xh_new = in - m_c * m_x_h;
-      auto y_l = m_c * xh_new + m_x_h;
-      m_x_h = xh_new;
-      if (std::is_same<TFilter, LowPass>::value)
+      const auto& settings = m_settings[band];
+      if (band == 0)
       {
-        return 0.5 * (m_v0 - 1) * (in + y_l) + in;
+        return Coefficients::lowShelf(m_fs, settings.frequency, settings.quality, settings.gainDb);
       }
-      else
+      if (band == Bands - 1)
       {
-        return 0.5 * (m_v0 - 1) * (in - y_l) + in;
+        return Coefficients::highShelf(m_fs, settings.frequency, settings.quality, settings.gainDb);
       }
+      return Coefficients::peak(m_fs, settings.frequency, settings.quality, settings.gainDb);
     }
 
   private:
-    float m_c_b{};
-    float m_c_c{};
-    float m_v0{};
-    float m_x_h{};
-    float m_c{};
-    float m_fs{};
-    float m_cutoff{};
+    std::uint32_t m_fs;
+    // Only prepare touches them, and prepare calls are serialised
+    mutable std::array<BandSettings, Bands> m_settings{};
 };
 
-class PeakFilter
+class SimpleEq : public AudioProcessor
 {
   public:
-    PeakFilter(std::uint32_t fs, float cutoff, float bandwidth)
-      : m_fs(fs)
-      , m_cutoff(cutoff)
-      , m_bandwidth(bandwidth)
+    SimpleEq(const AudioProcessingContext& context)
+      : m_designer(context.getSampleRate())
     {
-      calcCoeffs();
+      for (auto band = 0U; band < Bands; ++band)
+      {
+        m_cascade.setCoefficients(band, m_designer.design(band));
+      }
     }
 
-    inline void calcCoeffs()
+    void process(Sample* in_l, Sample* in_r, Sample* out_l, Sample* out_r, std::size_t numSamples) override
     {
-      auto tan = std::tan(3.141592 * m_bandwidth / m_fs) ;
-      m_d = -std::cos(2.0 * 3.141592 * m_cutoff / m_fs);
-      m_c_b = (tan - 1) / (tan + 1);
-      m_c_c = (tan - m_v0) / (tan + m_v0);
+      m_cascade.process(in_l, in_r, out_l, out_r, numSamples);
     }
 
-    inline void setGain(float gain)
+    // Both channels share a vector, so this only saves the right channel's
+    // loads and stores, but it keeps the chain mono after the EQ
+    bool preservesMono() const override
     {
-      gain -= 0.5;
-      m_v0 = std::pow(10, gain * 48.0 / 20.0);
-      if (gain >= 0.0)
-      {
-        m_c = m_c_b;
-      }
-      else
+      return true;
+    }
+
+    void processMono(Sample* in, Sample* out, std::size_t numSamples) override
+    {
+      const Sample* ins[] = { in };
+      Sample* outs[] = { out };
+      m_cascade.process(ins, outs, 1, numSamples);
+    }
+
+    void leaveMono() override
+    {
+      m_cascade.copyState(0, 1);
+    }
+
+    void setParameter(const AudioProcessor::Parameter& param) override
+    {
+      PreparedParameter prepared;
+      if (prepareParameter(param, prepared))
       {
-        calcCoeffs();
-        m_c = m_c_c;
+        applyParameter(prepared);
       }
     }
 
-    inline Sample filter(Sample in)
+    bool prepareParameter(const AudioProcessor::Parameter& param, PreparedParameter& prepared) const override
     {
-      auto xh = in - m_d * (1 - m_c) * m_x_h_1 + m_c * m_x_h_2;
-      auto y_l = -m_c * xh + m_d * (1 - m_c) * m_x_h_1 + m_x_h_2;
-      m_x_h_1 = xh;
-      m_x_h_2 = m_x_h_1;
-      return 0.5 * (m_v0 - 1) * (in - y_l) + in;
+      return m_designer.prepare(param, prepared);
+    }
+
+    void applyParameter(const PreparedParameter& prepared) override
+    {
+      m_cascade.setTarget(prepared.index, prepared.get<Coefficients>(), RampSamples);
     }
 
   private:
-    float m_x_h_1{};
-    float m_x_h_2{};
-    float m_v0{};
-    float m_d{};
-    float m_c_b{};
-    float m_c_c{};
-    float m_c{};
-    float m_fs{};
-    float m_cutoff{};
-    float m_bandwidth{};
+    EqDesigner m_designer;
+    dsp::BiquadCascade<Bands> m_cascade;
 };
-}
 
-class SimpleEq : public AudioProcessor
+// Many mono channels with the same settings, a channel per vector lane, so
+// that a group of channels costs about what a stereo instance does
+class SimpleEqBatch : public AudioProcessor
 {
   public:
-    SimpleEq(const AudioProcessingContext& context)
-      : m_fs(context.getSampleRate())
-      , m_low_l(m_fs, CutoffLow)
-      , m_low_r(m_fs, CutoffLow)
-      , m_high_l(m_fs, CutoffHigh)
-      , m_high_r(m_fs, CutoffHigh)
-      , m_peak_l(m_fs, CutoffMid, BandwidthMid)
-      , m_peak_r(m_fs, CutoffMid, BandwidthMid)
+    using Cascade = dsp::BiquadCascade<Bands, dsp::Vec8>;
+
+    SimpleEqBatch(const AudioProcessingContext& context, std::size_t numChannels)
+      : m_designer(context.getSampleRate())
+      , m_groups((numChannels + Cascade::Lanes - 1) / Cascade::Lanes)
     {
+      for (auto& group : m_groups)
+      {
+        for (auto band = 0U; band < Bands; ++band)
+        {
+          group.setCoefficients(band, m_designer.design(band));
+        }
+      }
     }
 
     void process(Sample* in_l, Sample* in_r, Sample* out_l, Sample* out_r, std::size_t numSamples) override
     {
-      while (numSamples--)
-      {
-        auto left = *in_l++;
-        auto right = *in_r++;
-
-        auto y_l = m_low_l.filter(left);
-        y_l = m_high_l.filter(y_l);
-        y_l = m_peak_l.filter(y_l);
-
-        auto y_r = m_low_r.filter(right);
-        y_r = m_high_r.filter(y_r);
-        y_r = m_peak_r.filter(y_r);
+      const Sample* in[] = { in_l, in_r };
+      Sample* out[] = { out_l, out_r };
+      processChannels(in, out, 2, numSamples);
+    }
 
-        *out_l++ = y_l;
-        *out_r++ = y_r;
+    void processChannels(const Sample* const* in, Sample* const* out, std::size_t numChannels, std::size_t numSamples) override
+    {
+      for (auto g = 0U; g < m_groups.size() && g * Cascade::Lanes < numChannels; ++g)
+      {
+        const auto first = g * Cascade::Lanes;
+        m_groups[g].process(in + first, out + first, std::min(Cascade::Lanes, numChannels - first), numSamples);
       }
     }
 
     void setParameter(const AudioProcessor::Parameter& param) override
     {
-      switch (param.index)
+      PreparedParameter prepared;
+      if (prepareParameter(param, prepared))
       {
-        case Low:
-          m_low_l.setGain(param.value);
-          m_low_r.setGain(param.value);
-          break;
-        case Mid:
-          m_peak_l.setGain(param.value);
-          m_peak_r.setGain(param.value);
-          break;
-        case High:
-          m_high_r.setGain(param.value);
-          m_high_l.setGain(param.value);
-          break;
+        applyParameter(prepared);
       }
     }
 
-  private:
-    float m_fs;
-    ShelvingFilter<LowPass> m_low_l;
-    ShelvingFilter<HighPass> m_high_l;
-    ShelvingFilter<LowPass> m_low_r;
-    ShelvingFilter<HighPass> m_high_r;
-    PeakFilter m_peak_l;
-    PeakFilter m_peak_r;
+    bool prepareParameter(const AudioProcessor::Parameter& param, PreparedParameter& prepared) const override
+    {
+      return m_designer.prepare(param, prepared);
+    }
 
+    void applyParameter(const PreparedParameter& prepared) override
+    {
+      for (auto& group : m_groups)
+      {
+        group.setTarget(prepared.index, prepared.get<Coefficients>(), RampSamples);
+      }
+    }
+
+  private:
+    EqDesigner m_designer;
+    dsp::AlignedVector<Cascade> m_groups;
 };
 
 class SimpleEqPlugin : public FxPlugin
@@ -212,13 +232,26 @@ class SimpleEqPlugin : public FxPlugin
   public:
     FxPluginInfo getPluginInfo() const override
     {
-      return {"Simple Eq", {"Low", "Mid", "High"}};
+      std::vector<std::string> parameters;
+      for (auto band = 1U; band <= Bands; ++band)
+      {
+        const auto prefix = "Band " + std::to_string(band);
+        parameters.push_back(prefix + " gain");
+        parameters.push_back(prefix + " freq");
+        parameters.push_back(prefix + " Q");
+      }
+      return {"Simple Eq", parameters};
     }
 
     AudioProcessor::Ptr createAudioProcessor(const AudioProcessingContext& context) const override
     {
       return std::make_unique<SimpleEq>(context);
     }
+
+    AudioProcessor::Ptr createBatchProcessor(const AudioProcessingContext& context, std::size_t numChannels) const override
+    {
+      return std::make_unique<SimpleEqBatch>(context, numChannels);
+    }
 };
 
 }
@@ -229,4 +262,3 @@ extern "C" FxPlugin::Ptr createFxPlugin()
 {
   return std::make_unique<SimpleEqPlugin>();
 }
-
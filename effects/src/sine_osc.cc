@@ -1,5 +1,7 @@
 #include <audio_processor.h>
 #include <fx_plugin.h>
+#include <oscillator.h>
+#include <algorithm>
 #include <memory>
 #include <cmath>
 
@@ -40,27 +42,34 @@ class SineOscillator : public AudioProcessor
      : m_fs(context.getSampleRate())
      , m_notes(generateCMajor())
     {
+      m_osc.setFrequency(m_notes[0], m_fs);
     }
 
     void process(Sample* in_l, Sample* in_r, Sample* out_l, Sample* out_r, std::size_t numSamples) override
     {
-      while (numSamples--)
-      {
-        auto t = m_phase++ * m_notes[m_index] / m_fs;
-        auto s = std::sin(2 * 3.141592 * t);
-        *out_l++ = *out_r++ = s;
-      }
+      m_osc.process(out_l, numSamples);
+      std::copy(out_l, out_l + numSamples, out_r);
+    }
+
+    bool preservesMono() const override
+    {
+      return true;
+    }
+
+    void processMono(Sample* /*in*/, Sample* out, std::size_t numSamples) override
+    {
+      m_osc.process(out, numSamples);
     }
 
     void setParameter(const AudioProcessor::Parameter& param) override
     {
-      m_index = 70.0 * param.value;
+      auto index = std::min<std::size_t>(m_notes.size() * param.value, m_notes.size() - 1);
+      m_osc.setFrequency(m_notes[index], m_fs);
     }
 
-    float m_phase = 0;
+    dsp::SineOscillator m_osc;
     std::vector<float> m_notes;
     std::uint32_t m_fs;
-    std::uint32_t m_index;
 };
 
 class SineOscillatorPlugin : public FxPlugin
@@ -25,29 +25,37 @@ class StateVariableFilter : public AudioProcessor
 
     void process(Sample* in_l, Sample* in_r, Sample* out_l, Sample* out_r, std::size_t numSamples) override
     {
-      while (numSamples--)
-      {
-        m_l_l = m_f1 * m_b_l + m_l_l;
-        m_h_l = *in_l++ - m_l_l - m_q1 * m_b_l;
-        m_b_l = m_f1 * m_h_l + m_b_l;
+      run(m_left, in_l, out_l, numSamples);
+      run(m_right, in_r, out_r, numSamples);
+    }
 
-        m_l_r = m_f1 * m_b_r + m_l_r;
-        m_h_r = *in_r++ - m_l_r - m_q1 * m_b_r;
-        m_b_r = m_f1 * m_h_r + m_b_r;
+    bool preservesMono() const override
+    {
+      return true;
+    }
 
-        *out_l++ = m_l_l * m_params[Lp] + m_b_l * m_params[Bp] + m_h_l * m_params[Hp];
-        *out_r++ = m_l_r * m_params[Lp] + m_b_r * m_params[Bp] + m_h_r * m_params[Hp];
-      }
+    void processMono(Sample* in, Sample* out, std::size_t numSamples) override
+    {
+      run(m_left, in, out, numSamples);
+    }
+
+    void leaveMono() override
+    {
+      m_right = m_left;
     }
 
     void setParameter(const AudioProcessor::Parameter& param) override
     {
+      PreparedParameter prepared;
+      if (prepareParameter(param, prepared))
+      {
+        applyParameter(prepared);
+        return;
+      }
+
       m_params[param.index] = param.value;
       switch (param.index)
       {
-        case Cutoff:
-          m_f1 = 2.0 * std::sin(3.141592 * 2000 * m_params[Cutoff] / m_fs);
-          break;
         case Resonance:
           m_q1 = 1 - m_params[Resonance];
           break;
@@ -56,13 +64,50 @@ class StateVariableFilter : public AudioProcessor
       }
     }
 
+    bool prepareParameter(const AudioProcessor::Parameter& param, PreparedParameter& prepared) const override
+    {
+      if (param.index != Cutoff)
+      {
+        return false;
+      }
+
+      prepared.index = Cutoff;
+      prepared.set(static_cast<float>(2.0 * std::sin(3.141592 * 2000 * param.value / m_fs)));
+      return true;
+    }
+
+    void applyParameter(const PreparedParameter& prepared) override
+    {
+      if (prepared.index == Cutoff)
+      {
+        m_f1 = prepared.get<float>();
+      }
+    }
+
+  private:
+    // Lowpass, bandpass and highpass of one channel
+    struct State
+    {
+      Sample l = 0;
+      Sample b = 0;
+      Sample h = 0;
+    };
+
+    void run(State& s, const Sample* in, Sample* out, std::size_t numSamples) const
+    {
+      while (numSamples--)
+      {
+        s.l = m_f1 * s.b + s.l;
+        s.h = *in++ - s.l - m_q1 * s.b;
+        s.b = m_f1 * s.h + s.b;
+
+        *out++ = s.l * m_params[Lp] + s.b * m_params[Bp] + s.h * m_params[Hp];
+      }
+    }
+
     std::vector<float> m_params {0.5, 0.0, 0.0, 0.0, 0.0};
-    Sample m_l_l = 0;
-    Sample m_b_l = 0;
-    Sample m_h_l = 0;
-    Sample m_l_r = 0;
-    Sample m_b_r = 0;
-    Sample m_h_r = 0;
+    State m_left;
+    State m_right;
     float m_f1 = 0;
     float m_q1 = 0;
     std::uint32_t m_fs;
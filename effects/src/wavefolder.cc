@@ -35,6 +35,20 @@ class WaveFolder : public AudioProcessor
       }
     }
 
+    bool preservesMono() const override
+    {
+      return true;
+    }
+
+    void processMono(Sample* in, Sample* out, std::size_t numSamples) override
+    {
+      while (numSamples--)
+      {
+        auto x = m_params[0] * *in++;
+        *out++ = sign(x) * 2 * std::abs(x / 2 - std::round(x / 2));
+      }
+    }
+
     void setParameter(const AudioProcessor::Parameter& param) override
     {
       m_params[param.index] = param.value * 10;
@@ -25,6 +25,19 @@ class WhiteNoiseSource : public AudioProcessor
       }
     }
 
+    bool preservesMono() const override
+    {
+      return true;
+    }
+
+    void processMono(Sample* /*in*/, Sample* out, std::size_t numSamples) override
+    {
+      while (numSamples--)
+      {
+        *out++ = m_dis(m_gen) * m_volume;
+      }
+    }
+
     void setParameter(const AudioProcessor::Parameter& param) override
     {
       m_volume = param.value;
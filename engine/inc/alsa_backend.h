@@ -0,0 +1,57 @@
+#ifndef ALSA_BACKEND_H
+#define ALSA_BACKEND_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "graph_backend.h"
+
+namespace awesomefx
+{
+
+// Runs the graph straight off an ALSA device through mmap, without a sound
+// server in between. Capture and playback are opened on the same device
+// with the same rate and period; the rate and channel counts the hardware
+// settles on may differ from the ones asked for.
+class AlsaBackend : public GraphBackend
+{
+  public:
+    struct Settings
+    {
+      std::string device = "hw:0";
+      std::uint32_t sampleRate = 48000;
+      std::uint32_t periodSize = 256;
+      std::uint32_t periods = 2;
+      // SCHED_FIFO priority of the audio thread, 0 leaves it as it is
+      int priority = 0;
+    };
+
+    AlsaBackend(const Settings& settings);
+    AlsaBackend(const AlsaBackend&) = delete;
+    ~AlsaBackend() override;
+
+    std::uint32_t getXruns() const;
+
+  private:
+    class Pcm;
+    struct Devices;
+
+    static std::unique_ptr<Devices> open(const Settings& settings);
+
+    AlsaBackend(std::unique_ptr<Devices> devices, const Settings& settings);
+    void run(int priority);
+    bool start();
+
+    std::unique_ptr<Devices> m_devices;
+    std::vector<std::vector<Sample>> m_capture;
+    std::vector<std::vector<Sample>> m_playback;
+    std::atomic<bool> m_running{true};
+    std::atomic<std::uint32_t> m_xruns{0};
+    std::thread m_thread;
+};
+
+}
+#endif /* ALSA_BACKEND_H */
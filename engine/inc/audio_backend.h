@@ -0,0 +1,28 @@
+#ifndef AUDIO_BACKEND_H
+#define AUDIO_BACKEND_H
+
+#include <string>
+#include <cstddef>
+#include <memory>
+#include <audio_processor.h>
+#include "audio_client.h"
+
+namespace awesomefx
+{
+
+// Where the chain runs: hands out the clients for its slots. Clients must not
+// outlive the backend that created them.
+class AudioBackend
+{
+  public:
+    using Ptr = std::unique_ptr<AudioBackend>;
+
+    virtual ~AudioBackend() {}
+
+    // The client is the context the processor is created with. Two channels
+    // are a stereo slot, any other count a batch slot.
+    virtual AudioClient::Ptr createClient(const std::string& name, const AudioProcessor::Factory& processorFactory, std::size_t numChannels) = 0;
+};
+
+}
+#endif /* AUDIO_BACKEND_H */
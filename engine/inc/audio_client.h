@@ -0,0 +1,57 @@
+#ifndef AUDIO_CLIENT_H
+#define AUDIO_CLIENT_H
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <audio_processor.h>
+#include "parameter_batch.h"
+#include "level_meter.h"
+#include "tracer.h"
+
+namespace awesomefx
+{
+
+// One chain slot as the audio backend runs it: a processor behind named
+// input and output ports that are wired up by name
+class AudioClient
+{
+  public:
+    using Ptr = std::unique_ptr<AudioClient>;
+    using Factory = std::function<Ptr(const std::string&, AudioProcessor::Factory, std::size_t numChannels)>;
+
+    virtual ~AudioClient() {}
+    virtual void connectInputsToCapturePorts(std::vector<std::string> portNames, bool mono) const = 0;
+    virtual void connectOutputsToPlaybackPorts() const = 0;
+    virtual std::vector<std::string> getInputPorts() const = 0;
+    virtual std::vector<std::string> getOutputPorts() const = 0;
+    virtual void connectInputs(const std::vector<std::string>& portNames) const = 0;
+    virtual void connectOutputs(const std::vector<std::string>& portNames) const = 0;
+    virtual void disconnectInputs() const = 0;
+    virtual void disconnectOutputsFromPlaybackPorts() const = 0;
+    virtual void setParameter(const AudioProcessor::Parameter& parameter) const = 0;
+    virtual void setParameter(const AudioProcessor::Parameter& parameter, const ParameterBatch& batch) const = 0;
+    // Samples the processor delays the signal by, also published as the
+    // latency between the client's ports where the backend has a notion of it
+    virtual std::uint32_t getLatency() const = 0;
+    // Whether a mono input gives a mono output
+    virtual bool preservesMono() const = 0;
+    // Tells a stereo client that both of its inputs carry the same signal,
+    // letting a processor that preserves mono compute only one channel
+    virtual void setMonoInput(bool mono) const = 0;
+    // A frame time that no process cycle has started at yet
+    virtual std::uint32_t getUpcomingFrameTime() const = 0;
+    virtual LevelMeter::Levels readLevels() const = 0;
+    virtual void startTrace() const = 0;
+    // Stops recording without waiting for the process thread
+    virtual void stopTrace() const = 0;
+    // The trace stopped by stopTrace, empty if the process thread does not
+    // complete a cycle by the deadline
+    virtual std::vector<TraceBuffer::Event> readTrace(std::chrono::steady_clock::time_point deadline) const = 0;
+};
+
+}
+#endif /* AUDIO_CLIENT_H */
@@ -2,10 +2,13 @@
 #define CONTROLLER_H
 
 #include "fx_plugin_handler.h"
-#include "jack_client.h"
+#include "audio_client.h"
 #include <configuration_backend.h>
 #include <fx_chain_configuration.h>
 #include <global_settings.h>
+#include <mutex>
+#include <chrono>
+#include "tracer.h"
 
 namespace awesomefx
 {
@@ -23,7 +26,7 @@ class ControllerImpl : public Controller
     ControllerImpl(
         std::vector<std::string> inputs,
         FxPluginHandler::Factory pluginHandlerFactory,
-        JackClient::Factory jackClientFactory,
+        AudioClient::Factory clientFactory,
         ConfigurationBackend::Ptr configBackend);
 
     ControllerImpl() = delete;
@@ -31,14 +34,25 @@ class ControllerImpl : public Controller
     void start() override;
 
   private:
+    // Guards the chain and the state read by the backend io threads. The
+    // chain structure and the plugin handler are only replaced from the
+    // backend worker, which serializes heavy operations.
+    mutable std::mutex m_mutex;
     std::vector<std::string> m_inputs;
     FxPluginHandler::Factory m_pluginHandlerFactory;
     FxPluginHandler::Ptr m_pluginHandler;
-    JackClient::Factory m_jackClientFactory;
+    AudioClient::Factory m_clientFactory;
     ConfigurationBackend::Ptr m_configBackend;
-    std::vector<JackClient::Ptr> m_fxChain;
+    // Declared before the chain, which must not outlive it
+    ParameterBatchGate m_batchGate;
+    std::vector<AudioClient::Ptr> m_fxChain;
     FxChainConfiguration m_currentConfig;
     GlobalSettings m_globalSettings;
+    // Control thread events, only recorded with the mutex held
+    TraceBuffer m_trace{4096};
+    bool m_tracing = false;
+    TraceClock::Ticks m_traceStartTicks = 0;
+    std::chrono::steady_clock::time_point m_traceStartTime;
 };
 
 }
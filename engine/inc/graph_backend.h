@@ -0,0 +1,94 @@
+#ifndef GRAPH_BACKEND_H
+#define GRAPH_BACKEND_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <utility>
+#include <audio_processor.h>
+#include "audio_backend.h"
+
+namespace awesomefx
+{
+
+// Runs the clients in process instead of in a sound server. The clients'
+// ports are wired up by name as they are in JACK, "<client>:in_left" and so
+// on, with system:capture_N and system:playback_N standing in for the
+// hardware. A driver thread calls cycle() once per period, which runs every
+// client in the order their connections require.
+class GraphBackend : public AudioBackend
+{
+  public:
+    GraphBackend(std::uint32_t sampleRate, std::uint32_t periodSize, std::size_t captureChannels, std::size_t playbackChannels);
+    GraphBackend(const GraphBackend&) = delete;
+    ~GraphBackend() override;
+
+    AudioClient::Ptr createClient(const std::string& name, const AudioProcessor::Factory& processorFactory, std::size_t numChannels) override;
+
+    std::uint32_t getSampleRate() const;
+    std::uint32_t getPeriodSize() const;
+    std::size_t getCaptureChannels() const;
+    std::size_t getPlaybackChannels() const;
+
+    // RT safe, driver thread only. Runs one period: capture holds a buffer
+    // per capture channel, playback gets a buffer per playback channel
+    // filled in.
+    void cycle(const Sample* const* capture, Sample* const* playback);
+
+  protected:
+    // Gives the calling thread SCHED_FIFO at the priority, warns if it may not
+    static void promoteToRealtime(int priority);
+
+  private:
+    class Client;
+    struct Schedule;
+    using Connection = std::pair<std::string, std::string>;
+
+    std::string nextName(const std::string& name);
+    void addClient(Client& client);
+    void removeClient(Client& client);
+    // Pairs the ports up over the longer side, repeating the shorter one.
+    // Returns false if a port does not exist, connecting nothing then.
+    bool connect(const std::vector<std::string>& sources, const std::vector<std::string>& destinations);
+    void disconnect(const std::function<bool(const Connection&)>& matches);
+    std::vector<std::string> capturePorts() const;
+    std::vector<std::string> playbackPorts() const;
+    std::uint32_t getUpcomingFrameTime() const;
+
+    // Called with the mutex held
+    void publishSchedule();
+    // Returns false if no cycle completed in time
+    bool waitForCycle() const;
+
+    const std::uint32_t m_sampleRate;
+    const std::uint32_t m_periodSize;
+    const std::size_t m_playbackChannels;
+    // Capture is copied here so that the schedule can point at it
+    std::vector<std::vector<Sample>> m_capture;
+
+    std::mutex m_mutex;
+    std::vector<Client*> m_clients;
+    // Source port, destination port
+    std::vector<Connection> m_connections;
+    std::size_t m_opened = 0;
+
+    std::unique_ptr<Schedule> m_published;
+    // Schedules the driver may still be walking, with the cycle count at
+    // which they were swapped out. Freed once a cycle has completed since.
+    std::vector<std::pair<std::unique_ptr<Schedule>, std::uint32_t>> m_retired;
+    std::atomic<Schedule*> m_schedule{nullptr};
+    // Frames run so far, driver thread only
+    std::uint64_t m_frames = 0;
+    // CLOCK_MONOTONIC nanoseconds at which frame 0 would have started, going
+    // by the start of the last cycle
+    std::atomic<std::int64_t> m_origin;
+    std::atomic<std::uint32_t> m_cycles{0};
+};
+
+}
+#endif /* GRAPH_BACKEND_H */
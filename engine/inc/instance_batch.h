@@ -0,0 +1,41 @@
+#ifndef INSTANCE_BATCH_H
+#define INSTANCE_BATCH_H
+
+#include <array>
+#include <cstddef>
+#include <vector>
+#include <audio_processor.h>
+#include <fx_plugin.h>
+
+namespace awesomefx
+{
+
+// Runs a batch slot for plugins without a batch processor of their own: one
+// stereo processor per channel pair, an odd last channel on both inputs of
+// its own processor. Saves the clients, not the per channel work.
+class InstanceBatch : public AudioProcessor
+{
+  public:
+    InstanceBatch(const FxPlugin& plugin, const AudioProcessingContext& context, std::size_t numChannels);
+
+    void process(Sample* in_l, Sample* in_r, Sample* out_l, Sample* out_r, std::size_t numSamples) override;
+    void processChannels(const Sample* const* in, Sample* const* out, std::size_t numChannels, std::size_t numSamples) override;
+    void setParameter(const Parameter& param) override;
+    bool prepareParameter(const Parameter& param, PreparedParameter& prepared) const override;
+    void applyParameter(const PreparedParameter& prepared) override;
+    std::uint32_t getLatency() const override;
+
+  private:
+    std::vector<AudioProcessor::Ptr> m_instances;
+    // The right output of an odd last channel goes nowhere
+    std::array<Sample, 256> m_discard;
+};
+
+// The processor for a slot of numChannels running the plugin: its stereo
+// processor for two channels, otherwise its batch processor or, lacking
+// one, an InstanceBatch
+AudioProcessor::Ptr createSlotProcessor(const FxPlugin& plugin, const AudioProcessingContext& context, std::size_t numChannels);
+
+}
+
+#endif /* INSTANCE_BATCH_H */
@@ -0,0 +1,24 @@
+#ifndef JACK_BACKEND_H
+#define JACK_BACKEND_H
+
+#include "audio_backend.h"
+#include "jack_client_pool.h"
+
+namespace awesomefx
+{
+
+// Every slot is a client of the JACK server, stereo ones from a pool
+class JackBackend : public AudioBackend
+{
+  public:
+    JackBackend(const std::string& prefix, std::size_t poolSize);
+    JackBackend(const JackBackend&) = delete;
+
+    AudioClient::Ptr createClient(const std::string& name, const AudioProcessor::Factory& processorFactory, std::size_t numChannels) override;
+
+  private:
+    JackClientPool m_pool;
+};
+
+}
+#endif /* JACK_BACKEND_H */
@@ -4,50 +4,35 @@
 #include <string>
 #include <vector>
 #include <jack/jack.h>
-#include <jack/ringbuffer.h>
 #include <cstdint>
-#include <functional>
 #include <memory>
 #include <audio_processor.h>
+#include "audio_client.h"
+#include "processor_runner.h"
 
 namespace awesomefx
 {
 
-class JackClient
-{
-  public:
-    using Ptr = std::unique_ptr<JackClient>;
-    using Factory = std::function<Ptr(const std::string&, AudioProcessor::Factory)>;
-
-    virtual ~JackClient() {}
-    virtual void connectInputsToCapturePorts(std::vector<std::string> portNames, bool mono) const = 0;
-    virtual void connectOutputsToPlaybackPorts() const = 0;
-    virtual std::vector<std::string> getInputPorts() const = 0;
-    virtual std::vector<std::string> getOutputPorts() const = 0;
-    virtual void connectInputs(const std::vector<std::string>& portNames) const = 0;
-    virtual void connectOutputs(const std::vector<std::string>& portNames) const = 0;
-    virtual void setParameter(const AudioProcessor::Parameter& parameter) const = 0;
-};
-
-class JackClientImpl : public JackClient,
+class JackClientImpl : public AudioClient,
                        public AudioProcessingContext
 {
   public:
-    struct PortPair
-    {
-      jack_port_t* left;
-      jack_port_t* right;
-    };
-
     struct ProcessCtx
     {
-      PortPair inputPorts;
-      PortPair outputPorts;
-      AudioProcessor::Ptr processor;
-      jack_ringbuffer_t *ringBuffer;
+      jack_client_t* client;
+      std::vector<jack_port_t*> inputPorts;
+      std::vector<jack_port_t*> outputPorts;
+      // Filled in by every cycle, sized with the ports
+      std::vector<Sample*> inputBuffers;
+      std::vector<Sample*> outputBuffers;
+      std::unique_ptr<ProcessorRunner> runner;
     };
 
-    JackClientImpl(const std::string& name, const AudioProcessor::Factory& processorFactory);
+    // Opens and activates a client without a processor, outputting silence.
+    // Two channels are a stereo slot, any other count a batch slot whose
+    // processor runs processChannels.
+    JackClientImpl(const std::string& name, std::size_t numChannels = 2);
+    JackClientImpl(const std::string& name, const AudioProcessor::Factory& processorFactory, std::size_t numChannels = 2);
     ~JackClientImpl() override;
     JackClientImpl() = delete;
 
@@ -57,14 +42,34 @@ class JackClientImpl : public JackClient,
     std::vector<std::string> getOutputPorts() const override;
     void connectInputs(const std::vector<std::string>& portNames) const override;
     void connectOutputs(const std::vector<std::string>& portNames) const override;
+    void disconnectInputs() const override;
+    void disconnectOutputsFromPlaybackPorts() const override;
     void setParameter(const AudioProcessor::Parameter& parameter) const override;
+    void setParameter(const AudioProcessor::Parameter& parameter, const ParameterBatch& batch) const override;
+    std::uint32_t getLatency() const override;
+    bool preservesMono() const override;
+    void setMonoInput(bool mono) const override;
+    std::uint32_t getUpcomingFrameTime() const override;
+    LevelMeter::Levels readLevels() const override;
+    void startTrace() const override;
+    void stopTrace() const override;
+    std::vector<TraceBuffer::Event> readTrace(std::chrono::steady_clock::time_point deadline) const override;
 
     std::uint32_t getSampleRate() const override;
+    std::size_t getNumChannels() const;
+
+    // Swaps the processor run by the client. Returns once the process
+    // callback no longer uses the previous one, which is then destroyed.
+    void setProcessor(AudioProcessor::Ptr processor, const std::string& name = "");
+    // See ProcessorRunner::reset
+    void reset() const;
+    void disconnectAll() const;
 
   private:
+    void writeMessage(const AudioProcessor::Parameter& parameter, const ParameterBatchGate* gate, std::uint32_t batch) const;
 
     jack_client_t* m_client;
-    ProcessCtx m_processCtx;
+    mutable ProcessCtx m_processCtx;
 };
 
 }
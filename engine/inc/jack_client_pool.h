@@ -0,0 +1,42 @@
+#ifndef JACK_CLIENT_POOL_H
+#define JACK_CLIENT_POOL_H
+
+#include "jack_client.h"
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace awesomefx
+{
+
+// Keeps opened and activated JACK clients around so that rebuilding a chain
+// does not pay for opening, registering ports and activating every slot.
+// Clients handed out by create() return to the pool when destroyed and must
+// not outlive it. Only stereo clients are pooled, batch slots get a client
+// of their own.
+class JackClientPool
+{
+  public:
+    JackClientPool(const std::string& prefix, std::size_t size);
+    JackClientPool() = delete;
+    JackClientPool(const JackClientPool&) = delete;
+    ~JackClientPool() = default;
+
+    AudioClient::Ptr create(const std::string& name, const AudioProcessor::Factory& processorFactory, std::size_t numChannels = 2);
+
+  private:
+    class PooledJackClient;
+
+    std::unique_ptr<JackClientImpl> acquire();
+    std::string nextName();
+    void release(std::unique_ptr<JackClientImpl> client);
+
+    std::string m_prefix;
+    std::mutex m_mutex;
+    std::vector<std::unique_ptr<JackClientImpl>> m_idle;
+    std::size_t m_opened = 0;
+};
+
+}
+
+#endif /* JACK_CLIENT_POOL_H */
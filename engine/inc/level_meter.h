@@ -0,0 +1,52 @@
+#ifndef LEVEL_METER_H
+#define LEVEL_METER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <jack/ringbuffer.h>
+#include <audio_processor.h>
+
+namespace awesomefx
+{
+
+// Measures block peak and RMS levels on the RT thread and hands decimated
+// frames to the control thread through a lock-free ring
+class LevelMeter
+{
+  public:
+    static const std::uint32_t FramesPerSecond = 30;
+
+    struct Levels
+    {
+      float peakLeft;
+      float peakRight;
+      float rmsLeft;
+      float rmsRight;
+    };
+
+    LevelMeter(std::uint32_t sampleRate);
+    LevelMeter(const LevelMeter&) = delete;
+    ~LevelMeter();
+
+    // RT safe
+    void process(const Sample* left, const Sample* right, std::size_t numSamples);
+
+    // Drains the frames written since the last call. Peaks are held over all
+    // of them, RMS is taken from the latest one.
+    Levels read();
+
+    // Forgets all levels, for a new signal. Only while process is not running.
+    void reset();
+
+  private:
+    jack_ringbuffer_t* m_frames;
+    std::uint32_t m_window;
+    std::uint32_t m_count = 0;
+    float m_peak[2] = {};
+    float m_power[2] = {};
+    Levels m_last = {};
+};
+
+}
+
+#endif /* LEVEL_METER_H */
@@ -0,0 +1,59 @@
+#ifndef NULL_BACKEND_H
+#define NULL_BACKEND_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <thread>
+#include <vector>
+#include "graph_backend.h"
+
+namespace awesomefx
+{
+
+// Runs the graph off a timer at the configured rate, without audio hardware:
+// the capture ports are silent or carry noise and playback is discarded
+class NullBackend : public GraphBackend
+{
+  public:
+    // Bins per period of the cycle time histogram
+    static constexpr std::size_t HistogramResolution = 1000;
+    // The last bin counts the cycles that took this many periods or longer
+    static constexpr std::size_t HistogramPeriods = 2;
+
+    struct Settings
+    {
+      std::uint32_t sampleRate = 48000;
+      std::uint32_t periodSize = 256;
+      std::size_t channels = 2;
+      // SCHED_FIFO priority of the timer thread, 0 leaves it as it is
+      int priority = 0;
+      // Feeds the capture ports white noise, so that processors are timed
+      // on a signal rather than on silence
+      bool noise = false;
+    };
+
+    NullBackend(const Settings& settings);
+    NullBackend(const NullBackend&) = delete;
+    ~NullBackend() override;
+
+    // Periods that started so late that they were skipped
+    std::uint32_t getOverruns() const;
+
+    // How many cycles took how long so far, bin i counting the cycles that
+    // took i to i + 1 HistogramResolutionths of a period
+    std::vector<std::uint32_t> readCycleTimes() const;
+
+  private:
+    void run(int priority);
+
+    std::vector<std::vector<Sample>> m_capture;
+    std::vector<std::vector<Sample>> m_playback;
+    std::atomic<bool> m_running{true};
+    std::atomic<std::uint32_t> m_overruns{0};
+    std::vector<std::atomic<std::uint32_t>> m_cycleTimes;
+    std::thread m_thread;
+};
+
+}
+#endif /* NULL_BACKEND_H */
@@ -0,0 +1,62 @@
+#ifndef PARAMETER_BATCH_H
+#define PARAMETER_BATCH_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace awesomefx
+{
+
+// Releases batches of parameter messages spread over several clients in the
+// same audio cycle. The control thread writes all messages of a batch first
+// and then commits the batch together with a frame time no cycle has started
+// at yet. Every client holds the messages back until its cycle starts at or
+// after that frame, so all of them apply the batch at the same boundary.
+class ParameterBatchGate
+{
+  public:
+    // Control thread only
+    std::uint32_t open()
+    {
+      return ++m_lastBatch;
+    }
+
+    // Control thread only
+    void commit(std::uint32_t batch, std::uint32_t frame)
+    {
+      auto& slot = m_commits[batch % m_commits.size()];
+      slot.store((static_cast<std::uint64_t>(batch) << 32) | frame, std::memory_order_release);
+    }
+
+    // RT safe
+    bool isReleased(std::uint32_t batch, std::uint32_t cycleStart) const
+    {
+      auto state = m_commits[batch % m_commits.size()].load(std::memory_order_acquire);
+      auto committed = static_cast<std::uint32_t>(state >> 32);
+      auto frame = static_cast<std::uint32_t>(state);
+
+      auto age = static_cast<std::int32_t>(committed - batch);
+      if (age < 0)
+      {
+        return false;
+      }
+
+      // A slot taken over by a newer batch means this one is long overdue
+      return age > 0 || static_cast<std::int32_t>(cycleStart - frame) >= 0;
+    }
+
+  private:
+    std::array<std::atomic<std::uint64_t>, 256> m_commits{};
+    std::uint32_t m_lastBatch = 0;
+};
+
+struct ParameterBatch
+{
+  const ParameterBatchGate* gate;
+  std::uint32_t id;
+};
+
+}
+
+#endif /* PARAMETER_BATCH_H */
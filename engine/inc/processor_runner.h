@@ -0,0 +1,112 @@
+#ifndef PROCESSOR_RUNNER_H
+#define PROCESSOR_RUNNER_H
+
+#include <string>
+#include <vector>
+#include <jack/ringbuffer.h>
+#include <cstdint>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <audio_processor.h>
+#include "parameter_batch.h"
+#include "level_meter.h"
+#include "tracer.h"
+
+namespace awesomefx
+{
+
+// Everything a backend client does besides moving audio: runs the processor
+// of a slot on the backend's process thread, applies queued parameter
+// messages at the frames they are due at, meters and traces. The backend
+// hands it the buffers and the frame time of every cycle.
+class ProcessorRunner
+{
+  public:
+    struct ParameterMessage
+    {
+      AudioProcessor::Parameter parameter;
+      const ParameterBatchGate* gate;
+      std::uint32_t batch;
+      // Frame time the message is due at, batches are due once released
+      std::uint32_t frame;
+      bool isPrepared;
+      AudioProcessor::PreparedParameter prepared;
+    };
+
+    ProcessorRunner(std::uint32_t sampleRate, std::size_t numChannels);
+    ProcessorRunner(const ProcessorRunner&) = delete;
+    ~ProcessorRunner();
+
+    // RT safe. Processes the cycle that starts at frame time cycleStart, or
+    // outputs silence without a processor.
+    void process(Sample* const* in, Sample* const* out, std::uint32_t numSamples, std::uint32_t cycleStart);
+
+    // Swaps the processor. Returns once process no longer uses the previous
+    // one, which is then destroyed. Without a cycle in time it is kept
+    // instead and destroyed by a later call once a cycle has completed.
+    void setProcessor(AudioProcessor::Ptr processor, const std::string& name = "");
+
+    // Queues a message to be applied in the cycle containing frame
+    void writeMessage(const AudioProcessor::Parameter& parameter, const ParameterBatchGate* gate, std::uint32_t batch, std::uint32_t frame);
+
+    // Returns once a cycle has completed after the call, or false after a
+    // timeout
+    bool waitForCycle() const;
+
+    std::size_t getNumChannels() const;
+    std::uint32_t getLatency() const;
+    bool preservesMono() const;
+    void setMonoInput(bool mono);
+    LevelMeter::Levels readLevels();
+    // Stops the trace and forgets the levels of the processors run so far,
+    // e.g. before a pooled client is handed to another slot. The levels are
+    // only reset once the runner is idle and process has finished with the
+    // last processor.
+    void reset();
+    void startTrace();
+    // Stops recording at once, so that a chain of runners can be stopped
+    // before any of them is waited for
+    void stopTrace();
+    // Returns the trace once a cycle has completed since stopTrace, waiting
+    // for one until the deadline, or nothing if none completes by then
+    std::vector<TraceBuffer::Event> readTrace(std::chrono::steady_clock::time_point deadline) const;
+
+  private:
+    bool applyParameters(AudioProcessor& processor, std::uint32_t cycleStart, std::uint32_t until, std::uint32_t& next);
+    void processBlock(AudioProcessor& processor, std::uint32_t numSamples);
+    void destroyRetired();
+    bool waitForCycleSince(std::uint32_t cycles, std::chrono::steady_clock::time_point deadline) const;
+
+    // A processor that may still be in use by process, with its name
+    struct Retired
+    {
+      AudioProcessor::Ptr processor;
+      std::unique_ptr<std::string> name;
+      std::uint32_t cycles;
+    };
+
+    std::atomic<AudioProcessor*> m_active{nullptr};
+    std::atomic<const char*> m_activeName{""};
+    std::atomic<std::uint32_t> m_cycles{0};
+    std::atomic<bool> m_monoInput{false};
+    // Process thread only. The processor of the last block, and whether it
+    // ran processMono since it last ran process.
+    const AudioProcessor* m_lastProcessor = nullptr;
+    bool m_ranMono = false;
+    std::atomic<std::uint32_t> m_latency{0};
+    jack_ringbuffer_t* m_ringBuffer;
+    LevelMeter m_meter;
+    TraceBuffer m_trace{32768};
+    std::uint32_t m_traceStopCycles = 0;
+    // Cursors into the buffers of the cycle, sized with the channels
+    std::vector<Sample*> m_inputs;
+    std::vector<Sample*> m_outputs;
+
+    AudioProcessor::Ptr m_processor;
+    std::unique_ptr<std::string> m_processorName;
+    std::vector<Retired> m_retired;
+};
+
+}
+#endif /* PROCESSOR_RUNNER_H */
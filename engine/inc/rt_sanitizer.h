@@ -0,0 +1,48 @@
+#ifndef RT_SANITIZER_H
+#define RT_SANITIZER_H
+
+namespace awesomefx
+{
+
+#ifdef AWESOMEFX_RT_SANITIZER
+
+namespace rtsan
+{
+  // Marks the calling thread as running real-time code on behalf of context.
+  // Allocations, locks and blocking syscalls made until the matching leave()
+  // are reported together with a backtrace.
+  void enter(const char* context);
+  void leave();
+}
+
+class RtScope
+{
+  public:
+    explicit RtScope(const char* context)
+    {
+      rtsan::enter(context);
+    }
+
+    ~RtScope()
+    {
+      rtsan::leave();
+    }
+
+    RtScope(const RtScope&) = delete;
+};
+
+#else
+
+class RtScope
+{
+  public:
+    explicit RtScope(const char*)
+    {
+    }
+};
+
+#endif
+
+}
+
+#endif /* RT_SANITIZER_H */
@@ -0,0 +1,88 @@
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace awesomefx
+{
+
+class TraceClock
+{
+  public:
+    using Ticks = std::uint64_t;
+
+    // Cheap enough for the RT thread, TSC where available
+    static Ticks now()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+      return __rdtsc();
+#else
+      return std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+    }
+};
+
+// Keeps the most recent events of one thread. Recording is wait-free and
+// allocation free; the buffer may only be read while no events are recorded.
+class TraceBuffer
+{
+  public:
+    struct Event
+    {
+      // Must have static storage duration
+      const char* name;
+      TraceClock::Ticks timestamp;
+      char phase;
+    };
+
+    TraceBuffer(std::size_t capacity);
+    TraceBuffer(const TraceBuffer&) = delete;
+
+    void start();
+    void stop();
+
+    // RT safe
+    void record(const char* name, char phase)
+    {
+      if (!m_enabled.load(std::memory_order_relaxed))
+      {
+        return;
+      }
+
+      auto w = m_written.load(std::memory_order_relaxed);
+      m_events[w & m_mask] = {name, TraceClock::now(), phase};
+      m_written.store(w + 1, std::memory_order_release);
+    }
+
+    void begin(const char* name)
+    {
+      record(name, 'B');
+    }
+
+    void end(const char* name)
+    {
+      record(name, 'E');
+    }
+
+    // Oldest first. Only call after stop() once the recording thread is done.
+    std::vector<Event> read() const;
+
+  private:
+    std::unique_ptr<Event[]> m_events;
+    std::size_t m_mask;
+    std::atomic<std::size_t> m_written{0};
+    std::atomic<bool> m_enabled{false};
+};
+
+}
+
+#endif /* TRACER_H */
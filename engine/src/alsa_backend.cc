@@ -0,0 +1,395 @@
+#include <alsa_backend.h>
+#include <alsa/asoundlib.h>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <stdexcept>
+
+using namespace awesomefx;
+
+namespace
+{
+
+const int WaitTimeoutMs = 1000;
+const auto RestartDelay = std::chrono::milliseconds(100);
+
+// In the order they are tried, floats spare the conversion
+const snd_pcm_format_t Formats[] = { SND_PCM_FORMAT_FLOAT, SND_PCM_FORMAT_S32, SND_PCM_FORMAT_S16 };
+
+void check(int result, const std::string& what)
+{
+  if (result < 0)
+  {
+    throw std::runtime_error(what + ": " + ::snd_strerror(result));
+  }
+}
+
+char* address(const snd_pcm_channel_area_t& area, snd_pcm_uframes_t frame)
+{
+  return static_cast<char*>(area.addr) + (area.first + frame * area.step) / 8;
+}
+
+Sample decode(const char* sample, snd_pcm_format_t format)
+{
+  switch (format)
+  {
+    case SND_PCM_FORMAT_FLOAT:
+      return *reinterpret_cast<const float*>(sample);
+    case SND_PCM_FORMAT_S32:
+      return *reinterpret_cast<const std::int32_t*>(sample) / 2147483648.0f;
+    default:
+      return *reinterpret_cast<const std::int16_t*>(sample) / 32768.0f;
+  }
+}
+
+void encode(Sample value, char* sample, snd_pcm_format_t format)
+{
+  value = std::clamp(value, -1.0f, 1.0f);
+  switch (format)
+  {
+    case SND_PCM_FORMAT_FLOAT:
+      *reinterpret_cast<float*>(sample) = value;
+      break;
+    case SND_PCM_FORMAT_S32:
+      *reinterpret_cast<std::int32_t*>(sample) = std::lrint(value * 2147483647.0);
+      break;
+    default:
+      *reinterpret_cast<std::int16_t*>(sample) = std::lrint(value * 32767.0f);
+      break;
+  }
+}
+}
+
+// One direction of the device, configured for mmap access
+class AlsaBackend::Pcm
+{
+  public:
+    // Capture has to match the rate and period playback settled on exactly
+    Pcm(const std::string& device, snd_pcm_stream_t stream, unsigned rate, snd_pcm_uframes_t periodSize, unsigned periods, bool exact)
+    {
+      check(::snd_pcm_open(&m_handle, device.c_str(), stream, 0), "Failed to open " + device);
+      try
+      {
+        configure(rate, periodSize, periods, exact);
+      }
+      catch (...)
+      {
+        ::snd_pcm_close(m_handle);
+        throw;
+      }
+    }
+
+    Pcm(const Pcm&) = delete;
+
+    ~Pcm()
+    {
+      ::snd_pcm_close(m_handle);
+    }
+
+    snd_pcm_t* getHandle() const
+    {
+      return m_handle;
+    }
+
+    unsigned getChannels() const
+    {
+      return m_channels;
+    }
+
+    unsigned getRate() const
+    {
+      return m_rate;
+    }
+
+    snd_pcm_uframes_t getPeriodSize() const
+    {
+      return m_periodSize;
+    }
+
+    snd_pcm_uframes_t getBufferSize() const
+    {
+      return m_bufferSize;
+    }
+
+    // The transfers block until the frames are moved and return a negative
+    // error code on an xrun. RT safe.
+    int read(Sample* const* buffers, snd_pcm_uframes_t numFrames)
+    {
+      return transfer(numFrames, [&](const snd_pcm_channel_area_t* areas, snd_pcm_uframes_t offset, snd_pcm_uframes_t done, snd_pcm_uframes_t frames) {
+        for (auto c = 0U; c < m_channels; ++c)
+        {
+          for (auto i = 0U; i < frames; ++i)
+          {
+            buffers[c][done + i] = decode(address(areas[c], offset + i), m_format);
+          }
+        }
+      });
+    }
+
+    int write(const Sample* const* buffers, snd_pcm_uframes_t numFrames)
+    {
+      return transfer(numFrames, [&](const snd_pcm_channel_area_t* areas, snd_pcm_uframes_t offset, snd_pcm_uframes_t done, snd_pcm_uframes_t frames) {
+        for (auto c = 0U; c < m_channels; ++c)
+        {
+          for (auto i = 0U; i < frames; ++i)
+          {
+            encode(buffers[c][done + i], address(areas[c], offset + i), m_format);
+          }
+        }
+      });
+    }
+
+    int writeSilence(snd_pcm_uframes_t numFrames)
+    {
+      return transfer(numFrames, [&](const snd_pcm_channel_area_t* areas, snd_pcm_uframes_t offset, snd_pcm_uframes_t, snd_pcm_uframes_t frames) {
+        ::snd_pcm_areas_silence(areas, offset, m_channels, frames, m_format);
+      });
+    }
+
+  private:
+    void configure(unsigned rate, snd_pcm_uframes_t periodSize, unsigned periods, bool exact)
+    {
+      snd_pcm_hw_params_t* hw;
+      snd_pcm_hw_params_alloca(&hw);
+      check(::snd_pcm_hw_params_any(m_handle, hw), "No configuration available");
+
+      if (::snd_pcm_hw_params_set_access(m_handle, hw, SND_PCM_ACCESS_MMAP_INTERLEAVED) < 0)
+      {
+        check(::snd_pcm_hw_params_set_access(m_handle, hw, SND_PCM_ACCESS_MMAP_NONINTERLEAVED), "No mmap access");
+      }
+
+      auto format = std::find_if(std::begin(Formats), std::end(Formats), [&](auto f) {
+        return ::snd_pcm_hw_params_set_format(m_handle, hw, f) == 0;
+      });
+      if (format == std::end(Formats))
+      {
+        throw std::runtime_error("No supported sample format");
+      }
+      m_format = *format;
+
+      m_channels = 2;
+      check(::snd_pcm_hw_params_set_channels_near(m_handle, hw, &m_channels), "Failed to set channels");
+
+      m_rate = rate;
+      m_periodSize = periodSize;
+      if (exact)
+      {
+        check(::snd_pcm_hw_params_set_rate(m_handle, hw, m_rate, 0), "Failed to set sample rate");
+        check(::snd_pcm_hw_params_set_period_size(m_handle, hw, m_periodSize, 0), "Failed to set period size");
+      }
+      else
+      {
+        check(::snd_pcm_hw_params_set_rate_near(m_handle, hw, &m_rate, 0), "Failed to set sample rate");
+        check(::snd_pcm_hw_params_set_period_size_near(m_handle, hw, &m_periodSize, 0), "Failed to set period size");
+      }
+
+      check(::snd_pcm_hw_params_set_periods_near(m_handle, hw, &periods, 0), "Failed to set periods");
+      check(::snd_pcm_hw_params(m_handle, hw), "Failed to apply hardware parameters");
+      check(::snd_pcm_hw_params_get_buffer_size(hw, &m_bufferSize), "Failed to get buffer size");
+
+      // Woken every period, and started by hand
+      snd_pcm_sw_params_t* sw;
+      snd_pcm_sw_params_alloca(&sw);
+      snd_pcm_uframes_t boundary;
+      check(::snd_pcm_sw_params_current(m_handle, sw), "Failed to get software parameters");
+      check(::snd_pcm_sw_params_get_boundary(sw, &boundary), "Failed to get boundary");
+      check(::snd_pcm_sw_params_set_avail_min(m_handle, sw, m_periodSize), "Failed to set minimum available");
+      check(::snd_pcm_sw_params_set_start_threshold(m_handle, sw, boundary), "Failed to set start threshold");
+      check(::snd_pcm_sw_params(m_handle, sw), "Failed to apply software parameters");
+    }
+
+    template<typename Transfer>
+    int transfer(snd_pcm_uframes_t numFrames, Transfer&& copy)
+    {
+      snd_pcm_uframes_t done = 0;
+      while (done < numFrames)
+      {
+        auto avail = ::snd_pcm_avail_update(m_handle);
+        if (avail < 0)
+        {
+          return avail;
+        }
+
+        if (avail == 0)
+        {
+          auto result = ::snd_pcm_wait(m_handle, WaitTimeoutMs);
+          if (result <= 0)
+          {
+            return result < 0 ? result : -EIO;
+          }
+          continue;
+        }
+
+        // Less than asked for where the buffer wraps
+        const snd_pcm_channel_area_t* areas;
+        snd_pcm_uframes_t offset;
+        snd_pcm_uframes_t frames = numFrames - done;
+        auto result = ::snd_pcm_mmap_begin(m_handle, &areas, &offset, &frames);
+        if (result < 0)
+        {
+          return result;
+        }
+
+        copy(areas, offset, done, frames);
+
+        auto committed = ::snd_pcm_mmap_commit(m_handle, offset, frames);
+        if (committed < 0)
+        {
+          return committed;
+        }
+        if (static_cast<snd_pcm_uframes_t>(committed) != frames)
+        {
+          return -EPIPE;
+        }
+        done += frames;
+      }
+      return 0;
+    }
+
+    snd_pcm_t* m_handle = nullptr;
+    snd_pcm_format_t m_format = SND_PCM_FORMAT_S16;
+    unsigned m_channels = 0;
+    unsigned m_rate = 0;
+    snd_pcm_uframes_t m_periodSize = 0;
+    snd_pcm_uframes_t m_bufferSize = 0;
+};
+
+struct AlsaBackend::Devices
+{
+  std::unique_ptr<Pcm> playback;
+  std::unique_ptr<Pcm> capture;
+  // Linked streams are started and stopped together
+  bool linked;
+};
+
+AlsaBackend::AlsaBackend(const Settings& settings)
+  : AlsaBackend(open(settings), settings)
+{
+}
+
+AlsaBackend::AlsaBackend(std::unique_ptr<Devices> devices, const Settings& settings)
+  : GraphBackend(devices->playback->getRate(), devices->playback->getPeriodSize(), devices->capture->getChannels(), devices->playback->getChannels())
+  , m_devices(std::move(devices))
+  , m_capture(getCaptureChannels(), std::vector<Sample>(getPeriodSize()))
+  , m_playback(getPlaybackChannels(), std::vector<Sample>(getPeriodSize()))
+  , m_thread([this, priority = settings.priority] { run(priority); })
+{
+}
+
+AlsaBackend::~AlsaBackend()
+{
+  m_running = false;
+  m_thread.join();
+  ::snd_pcm_drop(m_devices->playback->getHandle());
+  if (!m_devices->linked)
+  {
+    ::snd_pcm_drop(m_devices->capture->getHandle());
+  }
+}
+
+std::uint32_t AlsaBackend::getXruns() const
+{
+  return m_xruns.load(std::memory_order_relaxed);
+}
+
+std::unique_ptr<AlsaBackend::Devices> AlsaBackend::open(const Settings& settings)
+{
+  auto devices = std::make_unique<Devices>();
+  devices->playback = std::make_unique<Pcm>(settings.device, SND_PCM_STREAM_PLAYBACK, settings.sampleRate, settings.periodSize, settings.periods, false);
+
+  auto& playback = *devices->playback;
+  devices->capture = std::make_unique<Pcm>(settings.device, SND_PCM_STREAM_CAPTURE, playback.getRate(), playback.getPeriodSize(), settings.periods, true);
+  devices->linked = ::snd_pcm_link(devices->capture->getHandle(), playback.getHandle()) == 0;
+
+  printf("Opened %s at %u Hz, %lu frames per period, %u capture and %u playback channels\n",
+      settings.device.c_str(),
+      playback.getRate(),
+      static_cast<unsigned long>(playback.getPeriodSize()),
+      devices->capture->getChannels(),
+      playback.getChannels());
+
+  return devices;
+}
+
+// Prepares both streams, fills the playback buffer with silence and starts.
+// Playback then runs a buffer ahead of capture, which is the round trip
+// latency on top of the chain's.
+bool AlsaBackend::start()
+{
+  auto& playback = *m_devices->playback;
+  auto& capture = *m_devices->capture;
+
+  ::snd_pcm_drop(playback.getHandle());
+  if (!m_devices->linked)
+  {
+    ::snd_pcm_drop(capture.getHandle());
+  }
+
+  if (::snd_pcm_prepare(playback.getHandle()) < 0 ||
+      (!m_devices->linked && ::snd_pcm_prepare(capture.getHandle()) < 0))
+  {
+    return false;
+  }
+
+  if (playback.writeSilence(playback.getBufferSize()) < 0)
+  {
+    return false;
+  }
+
+  return ::snd_pcm_start(playback.getHandle()) == 0 &&
+    (m_devices->linked || ::snd_pcm_start(capture.getHandle()) == 0);
+}
+
+void AlsaBackend::run(int priority)
+{
+  if (priority > 0)
+  {
+    promoteToRealtime(priority);
+  }
+
+  auto& playback = *m_devices->playback;
+  auto& capture = *m_devices->capture;
+  const auto period = getPeriodSize();
+
+  std::vector<Sample*> captureBuffers;
+  std::vector<Sample*> playbackBuffers;
+  for (auto& buffer : m_capture)
+  {
+    captureBuffers.push_back(buffer.data());
+  }
+  for (auto& buffer : m_playback)
+  {
+    playbackBuffers.push_back(buffer.data());
+  }
+
+  auto restart = true;
+  while (m_running.load(std::memory_order_relaxed))
+  {
+    if (restart)
+    {
+      restart = !start();
+      if (restart)
+      {
+        printf("Warning: Failed to start the ALSA device\n");
+        std::this_thread::sleep_for(RestartDelay);
+        continue;
+      }
+    }
+
+    // Capture paces the cycles, playback has room for a period by then
+    auto error = capture.read(captureBuffers.data(), period);
+    if (!error)
+    {
+      cycle(captureBuffers.data(), playbackBuffers.data());
+      error = playback.write(playbackBuffers.data(), period);
+    }
+
+    if (error < 0)
+    {
+      m_xruns.fetch_add(1, std::memory_order_relaxed);
+      restart = true;
+    }
+  }
+}
@@ -1,18 +1,63 @@
 #include "controller.h"
+#include "instance_batch.h"
 #include <fx_chain_configuration.h>
 #include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <utility>
 
 using namespace awesomefx;
 
+namespace
+{
+
+const std::size_t NoSlot = static_cast<std::size_t>(-1);
+const std::uint32_t MaxChannels = 128;
+// How long a stopped trace waits for the slots' process threads, in total
+const auto TraceTimeout = std::chrono::seconds(1);
+
+// For each requested slot, finds a live slot running the same plugin that
+// can be reused, preferring the one at the same position
+std::vector<std::size_t> matchSlots(const FxChainConfiguration& live, const FxChainConfiguration& requested)
+{
+  std::vector<std::size_t> reused(requested.size(), NoSlot);
+  std::vector<bool> taken(live.size(), false);
+
+  auto match = [&](std::size_t i, std::size_t j) {
+    if (reused[i] == NoSlot && !taken[j] && live[j].name == requested[i].name && live[j].channels == requested[i].channels)
+    {
+      reused[i] = j;
+      taken[j] = true;
+    }
+  };
+
+  for (auto i = 0U; i < std::min(live.size(), requested.size()); ++i)
+  {
+    match(i, i);
+  }
+
+  for (auto i = 0U; i < requested.size(); ++i)
+  {
+    for (auto j = 0U; j < live.size(); ++j)
+    {
+      match(i, j);
+    }
+  }
+
+  return reused;
+}
+
+}
+
 ControllerImpl::ControllerImpl(
         std::vector<std::string> inputs,
         FxPluginHandler::Factory pluginHandlerFactory,
-        JackClient::Factory jackClientFactory,
+        AudioClient::Factory clientFactory,
         ConfigurationBackend::Ptr configBackend)
   :
     m_inputs(std::move(inputs)),
     m_pluginHandlerFactory(std::move(pluginHandlerFactory)),
-    m_jackClientFactory(std::move(jackClientFactory)),
+    m_clientFactory(std::move(clientFactory)),
     m_configBackend(std::move(configBackend))
 {
   m_pluginHandler = m_pluginHandlerFactory();
@@ -20,45 +65,170 @@ ControllerImpl::ControllerImpl(
 
 void ControllerImpl::start()
 {
-  auto onApplyConfig = [this](const FxChainConfiguration& config) {
-    m_fxChain.clear();
-    m_currentConfig = config;
+  // The capture signal stays mono up to the first slot that does not
+  // preserve it. Called from the worker, the only thread changing the chain.
+  auto updateMonoInputs = [this] {
+    auto mono = m_globalSettings.monoInput;
+    for (auto& client : m_fxChain)
+    {
+      client->setMonoInput(mono);
+      mono = mono && client->preservesMono();
+    }
+  };
 
-    if (config.empty())
+  auto onApplyConfig = [this, updateMonoInputs](const FxChainConfiguration& config) {
+    // Resolve all plugins up front so that a bad config leaves the chain untouched
+    std::vector<const FxPlugin*> plugins;
+    for (auto& effect : config)
     {
-      return;
+      if (effect.channels < 1 || effect.channels > MaxChannels)
+      {
+        throw std::invalid_argument("Invalid channel count: " + std::to_string(effect.channels));
+      }
+      plugins.push_back(&m_pluginHandler->getPlugin(effect.name));
     }
 
+    // After a failed reload the configuration is kept without its slots,
+    // which leaves nothing to reuse
+    FxChainConfiguration liveConfig;
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if (m_fxChain.size() == m_currentConfig.size())
+      {
+        liveConfig = m_currentConfig;
+      }
+    }
+
+    auto reused = matchSlots(liveConfig, config);
+
+    // Instantiate the new processors while the live chain keeps running and
+    // receiving parameters
+    std::vector<AudioClient::Ptr> created(config.size());
     for (auto i = 0U; i < config.size(); ++i)
     {
+      if (reused[i] != NoSlot)
+      {
+        continue;
+      }
+
       auto& effect = config[i];
-      auto& plugin = m_pluginHandler->getPlugin(effect.name);
+      auto& plugin = *plugins[i];
 
-      auto processorFactory = [&plugin] (auto& context) {
-        return plugin.createAudioProcessor(context);
+      auto processorFactory = [&plugin, channels = effect.channels] (auto& context) {
+        return createSlotProcessor(plugin, context, channels);
       };
 
-      auto client = m_jackClientFactory(effect.name, processorFactory);
+      created[i] = m_clientFactory(effect.name, processorFactory, effect.channels);
 
       for (auto param = 0U; param < effect.parameters.size(); ++param)
       {
-        client->setParameter({param, effect.parameters[param]});
+        created[i]->setParameter({param, effect.parameters[param]});
       }
+    }
+
+    // Only the swap happens under the lock, tearing down and wiring up
+    // slots is left to the worker so that parameter and level requests are
+    // not held up by it
+    std::vector<AudioClient::Ptr> oldChain;
+    std::vector<AudioClient*> oldClients;
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_trace.begin("swap chain");
+
+      oldChain = std::move(m_fxChain);
+      auto oldConfig = std::move(m_currentConfig);
+      for (auto& client : oldChain)
+      {
+        oldClients.push_back(client.get());
+      }
+
+      // Reused slots only get the parameters that changed
+      std::vector<AudioClient::Ptr> fxChain;
+      for (auto i = 0U; i < config.size(); ++i)
+      {
+        if (reused[i] == NoSlot)
+        {
+          if (m_tracing)
+          {
+            created[i]->startTrace();
+          }
+          fxChain.push_back(std::move(created[i]));
+          continue;
+        }
+
+        auto& client = oldChain[reused[i]];
+        auto& oldParams = oldConfig[reused[i]].parameters;
+        auto& params = config[i].parameters;
+        for (auto param = 0U; param < params.size(); ++param)
+        {
+          if (param >= oldParams.size() || oldParams[param] != params[param])
+          {
+            client->setParameter({param, params[param]});
+          }
+        }
+        fxChain.push_back(std::move(client));
+      }
+
+      m_fxChain = std::move(fxChain);
+      m_currentConfig = config;
+      m_trace.end("swap chain");
+    }
+
+    // Whatever was not reused goes away along with its connections
+    oldChain.clear();
+
+    auto oldSource = [&](AudioClient* client) -> AudioClient* {
+      auto it = std::find(oldClients.begin(), oldClients.end(), client);
+      return it == oldClients.begin() ? nullptr : *(it - 1);
+    };
+
+    auto oldLast = oldClients.empty() ? nullptr : oldClients.back();
+    auto newLast = m_fxChain.empty() ? nullptr : m_fxChain.back().get();
+    auto oldLastReused = oldLast &&
+      std::find(reused.begin(), reused.end(), oldClients.size() - 1) != reused.end();
+
+    if (oldLastReused && oldLast != newLast)
+    {
+      oldLast->disconnectOutputsFromPlaybackPorts();
+    }
 
-      if (i > 0)
+    // Only reconnect the edges that changed
+    for (auto i = 0U; i < m_fxChain.size(); ++i)
+    {
+      auto client = m_fxChain[i].get();
+      auto source = i > 0 ? m_fxChain[i-1].get() : nullptr;
+
+      if (reused[i] != NoSlot)
+      {
+        if (oldSource(client) == source)
+        {
+          continue;
+        }
+        client->disconnectInputs();
+      }
+
+      if (source)
       {
-        client->connectInputs(m_fxChain[i-1]->getOutputPorts());
+        client->connectInputs(source->getOutputPorts());
       }
-      m_fxChain.push_back(std::move(client));
+      else
+      {
+        client->connectInputsToCapturePorts(m_inputs, m_globalSettings.monoInput);
+      }
+    }
+
+    if (newLast && newLast != oldLast)
+    {
+      newLast->connectOutputsToPlaybackPorts();
     }
 
-    m_fxChain.front()->connectInputsToCapturePorts(m_inputs, m_globalSettings.monoInput);
-    m_fxChain.back()->connectOutputsToPlaybackPorts();
+    updateMonoInputs();
   };
 
   m_configBackend->registerOnApplyConfig(onApplyConfig);
 
   auto onGetPlugins = [this]() {
+    std::lock_guard<std::mutex> lock(m_mutex);
     AvailablePlugins plugins;
     auto allPlugins = m_pluginHandler->getAllPlugins();
     std::transform(
@@ -75,12 +245,19 @@ void ControllerImpl::start()
   m_configBackend->registerOnGetPlugins(onGetPlugins);
 
   auto onGetConfig = [this] () {
-    return m_currentConfig;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto config = m_currentConfig;
+    for (auto i = 0U; i < config.size(); ++i)
+    {
+      config[i].latency = i < m_fxChain.size() ? m_fxChain[i]->getLatency() : 0;
+    }
+    return config;
   };
 
   m_configBackend->registerOnGetConfig(onGetConfig);
 
   auto onSetParameters = [this] (std::uint32_t index, const std::vector<ParameterValue>& params) {
+    std::lock_guard<std::mutex> lock(m_mutex);
     if (index >= m_fxChain.size())
     {
       return;
@@ -91,32 +268,209 @@ void ControllerImpl::start()
     {
       fx->setParameter({i, params[i]});
     }
+
+    auto& current = m_currentConfig[index].parameters;
+    current.resize(std::max(current.size(), params.size()));
+    std::copy(params.begin(), params.end(), current.begin());
   };
 
   m_configBackend->registerOnSetParameters(onSetParameters);
 
+  auto onSetParameterBatch = [this] (const ParameterUpdates& updates) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    for (auto& update : updates)
+    {
+      if (update.slot >= m_fxChain.size())
+      {
+        throw std::invalid_argument("Invalid slot: " + std::to_string(update.slot));
+      }
+
+      auto& plugin = m_pluginHandler->getPlugin(m_currentConfig[update.slot].name);
+      if (update.index >= plugin.getPluginInfo().parameters.size())
+      {
+        throw std::invalid_argument("Invalid parameter index: " + std::to_string(update.index));
+      }
+
+      if (!std::isfinite(update.value))
+      {
+        throw std::invalid_argument("Invalid parameter value");
+      }
+    }
+
+    if (updates.empty())
+    {
+      return;
+    }
+
+    m_trace.begin("parameter batch");
+    auto batch = m_batchGate.open();
+    auto commit = [&] {
+      m_batchGate.commit(batch, m_fxChain.front()->getUpcomingFrameTime());
+    };
+
+    try
+    {
+      for (auto& update : updates)
+      {
+        m_fxChain[update.slot]->setParameter({update.index, update.value}, {&m_batchGate, batch});
+      }
+    }
+    catch (...)
+    {
+      // Never leave a partially written batch blocking the clients
+      commit();
+      m_trace.end("parameter batch");
+      throw;
+    }
+
+    commit();
+    m_trace.end("parameter batch");
+
+    for (auto& update : updates)
+    {
+      auto& current = m_currentConfig[update.slot].parameters;
+      current.resize(std::max<std::size_t>(current.size(), update.index + 1));
+      current[update.index] = update.value;
+    }
+  };
+
+  m_configBackend->registerOnSetParameterBatch(onSetParameterBatch);
+
+  // The configuration stays current if the reloaded plugins fail to apply
+  // it, so that the next reload can bring the chain back
   auto onReload = [=] {
-    m_fxChain.clear();
-    m_pluginHandler.reset();
-    m_pluginHandler = m_pluginHandlerFactory();
-    onApplyConfig(m_currentConfig);
+    FxChainConfiguration config;
+    {
+      // Processors must be gone before their plugins are unloaded
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_fxChain.clear();
+      config = m_currentConfig;
+      m_pluginHandler.reset();
+      m_pluginHandler = m_pluginHandlerFactory();
+    }
+    onApplyConfig(config);
   };
 
   m_configBackend->registerOnReload(onReload);
 
-  auto onApplyGlobalSettings = [=](const GlobalSettings& settings) {
-    m_globalSettings = settings;
-    onApplyConfig(m_currentConfig);
+  auto onApplyGlobalSettings = [this, updateMonoInputs](const GlobalSettings& settings) {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_globalSettings = settings;
+    }
+
+    // Rewired outside the lock, as onApplyConfig does; the worker is the
+    // only thread changing the chain. No slot may take the input for mono
+    // while it is still stereo.
+    if (!m_globalSettings.monoInput)
+    {
+      updateMonoInputs();
+    }
+
+    // Only the capture edge depends on the settings
+    if (!m_fxChain.empty())
+    {
+      m_fxChain.front()->disconnectInputs();
+      m_fxChain.front()->connectInputsToCapturePorts(m_inputs, m_globalSettings.monoInput);
+    }
+
+    updateMonoInputs();
   };
 
   m_configBackend->registerOnApplyGlobalSettings(onApplyGlobalSettings);
 
   auto onGetGlobalSettings = [this] {
+    std::lock_guard<std::mutex> lock(m_mutex);
     return m_globalSettings;
   };
 
   m_configBackend->registerOnGetGlobalSettings(onGetGlobalSettings);
 
+  auto onGetLevels = [this] {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ChainLevels levels;
+    std::transform(
+        m_fxChain.begin(),
+        m_fxChain.end(),
+        std::back_inserter(levels),
+        [](auto& fx) {
+        auto l = fx->readLevels();
+        return SlotLevels { l.peakLeft, l.peakRight, l.rmsLeft, l.rmsRight };
+        });
+    return levels;
+  };
+
+  m_configBackend->registerOnGetLevels(onGetLevels);
+
+  auto onStartTrace = [this] {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_tracing)
+    {
+      return;
+    }
+
+    m_tracing = true;
+    m_traceStartTime = std::chrono::steady_clock::now();
+    m_traceStartTicks = TraceClock::now();
+
+    m_trace.start();
+    for (auto& fx : m_fxChain)
+    {
+      fx->startTrace();
+    }
+  };
+
+  m_configBackend->registerOnStartTrace(onStartTrace);
+
+  auto onStopTrace = [this] {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Trace trace;
+    if (!m_tracing)
+    {
+      return trace;
+    }
+
+    m_tracing = false;
+    m_trace.stop();
+
+    std::vector<std::vector<TraceBuffer::Event>> tracks;
+    tracks.push_back(m_trace.read());
+    trace.tracks.push_back("controller");
+
+    // Every slot stops before any is waited for, so the waits overlap and
+    // the lock is held for about a period, and at most one timeout
+    for (auto& fx : m_fxChain)
+    {
+      fx->stopTrace();
+    }
+
+    auto deadline = std::chrono::steady_clock::now() + TraceTimeout;
+    for (auto i = 0U; i < m_fxChain.size(); ++i)
+    {
+      tracks.push_back(m_fxChain[i]->readTrace(deadline));
+      trace.tracks.push_back("slot " + std::to_string(i) + ": " + m_currentConfig[i].name);
+    }
+
+    // Calibrate the clock ticks against the time the trace ran for
+    auto elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - m_traceStartTime);
+    auto ticks = static_cast<double>(TraceClock::now() - m_traceStartTicks);
+    auto ticksPerMicrosecond = elapsed.count() > 0 ? ticks / elapsed.count() : 1.0;
+
+    for (auto track = 0U; track < tracks.size(); ++track)
+    {
+      for (auto& event : tracks[track])
+      {
+        auto offset = static_cast<double>(static_cast<std::int64_t>(event.timestamp - m_traceStartTicks));
+        trace.records.push_back({event.name, event.phase, offset / ticksPerMicrosecond, track});
+      }
+    }
+
+    return trace;
+  };
+
+  m_configBackend->registerOnStopTrace(onStopTrace);
+
   printf("Available plugins:\n\n");
   for (auto plugin : onGetPlugins())
   {
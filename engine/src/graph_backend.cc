@@ -0,0 +1,643 @@
+#include <graph_backend.h>
+#include <processor_runner.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <map>
+#include <stdexcept>
+#include <thread>
+#include <pthread.h>
+#include <sched.h>
+
+using namespace awesomefx;
+
+namespace
+{
+
+const auto CycleTimeout = std::chrono::seconds(1);
+const std::int64_t NanosecondsPerSecond = 1000000000;
+
+std::int64_t monotonicNow()
+{
+  timespec now;
+  ::clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec * NanosecondsPerSecond + now.tv_nsec;
+}
+
+// Stereo slots get the port names they have in JACK
+std::string portName(const std::string& client, const char* direction, std::size_t channel, std::size_t numChannels)
+{
+  if (numChannels == 2)
+  {
+    return client + ":" + direction + (channel == 0 ? "_left" : "_right");
+  }
+  return client + ":" + direction + "_" + std::to_string(channel + 1);
+}
+
+std::vector<std::string> systemPorts(const char* direction, std::size_t numChannels)
+{
+  std::vector<std::string> names;
+  for (auto c = 0U; c < numChannels; ++c)
+  {
+    names.push_back(std::string("system:") + direction + "_" + std::to_string(c + 1));
+  }
+  return names;
+}
+
+bool contains(const std::vector<std::string>& names, const std::string& name)
+{
+  return std::find(names.begin(), names.end(), name) != names.end();
+}
+
+// Sums the sources into destination, silence without any
+void mix(const std::vector<Sample*>& sources, Sample* destination, std::uint32_t numSamples)
+{
+  if (sources.empty())
+  {
+    std::memset(destination, 0, sizeof(Sample) * numSamples);
+    return;
+  }
+
+  std::memcpy(destination, sources[0], sizeof(Sample) * numSamples);
+  for (auto s = 1U; s < sources.size(); ++s)
+  {
+    for (auto i = 0U; i < numSamples; ++i)
+    {
+      destination[i] += sources[s][i];
+    }
+  }
+}
+}
+
+// What the driver thread runs, rebuilt on the control thread whenever the
+// clients or their connections change
+struct GraphBackend::Schedule
+{
+  struct Mix
+  {
+    Sample* destination;
+    std::vector<Sample*> sources;
+  };
+
+  struct Step
+  {
+    ProcessorRunner* runner;
+    // Inputs with more than one connection or none are mixed into the
+    // client's own buffers, the others read their source directly
+    std::vector<Mix> mixes;
+    std::vector<Sample*> inputs;
+    std::vector<Sample*> outputs;
+  };
+
+  std::vector<Step> steps;
+  // The sources of every playback channel
+  std::vector<std::vector<Sample*>> playback;
+};
+
+class GraphBackend::Client : public AudioClient,
+                             public AudioProcessingContext
+{
+  public:
+    Client(GraphBackend& backend, const std::string& name, std::size_t numChannels)
+      : m_backend(backend)
+      , m_name(backend.nextName(name))
+      , m_runner(backend.getSampleRate(), numChannels)
+      , m_inputBuffers(numChannels, std::vector<Sample>(backend.getPeriodSize()))
+      , m_outputBuffers(numChannels, std::vector<Sample>(backend.getPeriodSize()))
+    {
+      for (auto c = 0U; c < numChannels; ++c)
+      {
+        m_inputPorts.push_back(portName(m_name, "in", c, numChannels));
+        m_outputPorts.push_back(portName(m_name, "out", c, numChannels));
+      }
+      m_backend.addClient(*this);
+    }
+
+    ~Client() override
+    {
+      m_backend.removeClient(*this);
+    }
+
+    const std::string& getName() const
+    {
+      return m_name;
+    }
+
+    ProcessorRunner& getRunner()
+    {
+      return m_runner;
+    }
+
+    Sample* getInputBuffer(std::size_t channel)
+    {
+      return m_inputBuffers[channel].data();
+    }
+
+    Sample* getOutputBuffer(std::size_t channel)
+    {
+      return m_outputBuffers[channel].data();
+    }
+
+    void setProcessor(AudioProcessor::Ptr processor, const std::string& name)
+    {
+      m_runner.setProcessor(std::move(processor), name);
+    }
+
+    void connectInputsToCapturePorts(std::vector<std::string> portNames, bool mono) const override
+    {
+      if (portNames.empty())
+      {
+        portNames = m_backend.capturePorts();
+      }
+
+      if (portNames.size() < 1)
+      {
+        throw std::runtime_error("There must be at least one capture port");
+      }
+
+      if (mono)
+      {
+        portNames.resize(1);
+      }
+
+      if (!m_backend.connect(portNames, m_inputPorts))
+      {
+        throw std::runtime_error("Failed to connect input to capture ports");
+      }
+    }
+
+    void connectOutputsToPlaybackPorts() const override
+    {
+      auto portNames = m_backend.playbackPorts();
+      if (portNames.empty())
+      {
+        throw std::runtime_error("There must be at least one playback port");
+      }
+
+      // A slot of any width goes round the first two
+      portNames.resize(std::min<std::size_t>(portNames.size(), 2));
+
+      if (!m_backend.connect(m_outputPorts, portNames))
+      {
+        throw std::runtime_error("Failed to connect output ports to playback ports");
+      }
+    }
+
+    std::vector<std::string> getInputPorts() const override
+    {
+      return m_inputPorts;
+    }
+
+    std::vector<std::string> getOutputPorts() const override
+    {
+      return m_outputPorts;
+    }
+
+    void connectInputs(const std::vector<std::string>& portNames) const override
+    {
+      if (!m_backend.connect(portNames, m_inputPorts))
+      {
+        throw std::runtime_error("Failed to connect input ports");
+      }
+    }
+
+    void connectOutputs(const std::vector<std::string>& portNames) const override
+    {
+      if (!m_backend.connect(m_outputPorts, portNames))
+      {
+        throw std::runtime_error("Failed to connect output ports");
+      }
+    }
+
+    void disconnectInputs() const override
+    {
+      m_backend.disconnect([this](const Connection& connection) {
+        return contains(m_inputPorts, connection.second);
+      });
+    }
+
+    void disconnectOutputsFromPlaybackPorts() const override
+    {
+      auto playback = m_backend.playbackPorts();
+      m_backend.disconnect([this, &playback](const Connection& connection) {
+        return contains(m_outputPorts, connection.first) && contains(playback, connection.second);
+      });
+    }
+
+    void setParameter(const AudioProcessor::Parameter& parameter) const override
+    {
+      m_runner.writeMessage(parameter, nullptr, 0, getUpcomingFrameTime());
+    }
+
+    void setParameter(const AudioProcessor::Parameter& parameter, const ParameterBatch& batch) const override
+    {
+      m_runner.writeMessage(parameter, batch.gate, batch.id, getUpcomingFrameTime());
+    }
+
+    std::uint32_t getLatency() const override
+    {
+      return m_runner.getLatency();
+    }
+
+    bool preservesMono() const override
+    {
+      return m_runner.preservesMono();
+    }
+
+    void setMonoInput(bool mono) const override
+    {
+      m_runner.setMonoInput(mono);
+    }
+
+    std::uint32_t getUpcomingFrameTime() const override
+    {
+      return m_backend.getUpcomingFrameTime();
+    }
+
+    LevelMeter::Levels readLevels() const override
+    {
+      return m_runner.readLevels();
+    }
+
+    void startTrace() const override
+    {
+      m_runner.startTrace();
+    }
+
+    void stopTrace() const override
+    {
+      m_runner.stopTrace();
+    }
+
+    std::vector<TraceBuffer::Event> readTrace(std::chrono::steady_clock::time_point deadline) const override
+    {
+      return m_runner.readTrace(deadline);
+    }
+
+    std::uint32_t getSampleRate() const override
+    {
+      return m_backend.getSampleRate();
+    }
+
+  private:
+    GraphBackend& m_backend;
+    std::string m_name;
+    mutable ProcessorRunner m_runner;
+    std::vector<std::vector<Sample>> m_inputBuffers;
+    std::vector<std::vector<Sample>> m_outputBuffers;
+    std::vector<std::string> m_inputPorts;
+    std::vector<std::string> m_outputPorts;
+};
+
+GraphBackend::GraphBackend(std::uint32_t sampleRate, std::uint32_t periodSize, std::size_t captureChannels, std::size_t playbackChannels)
+  : m_sampleRate(sampleRate)
+  , m_periodSize(periodSize)
+  , m_playbackChannels(playbackChannels)
+  , m_capture(captureChannels, std::vector<Sample>(periodSize))
+  , m_origin(monotonicNow())
+{
+  if (sampleRate == 0 || periodSize == 0)
+  {
+    throw std::invalid_argument("Invalid sample rate or period size");
+  }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  publishSchedule();
+}
+
+GraphBackend::~GraphBackend() = default;
+
+AudioClient::Ptr GraphBackend::createClient(const std::string& name, const AudioProcessor::Factory& processorFactory, std::size_t numChannels)
+{
+  if (numChannels == 0)
+  {
+    throw std::runtime_error("A client needs at least one channel");
+  }
+
+  auto client = std::make_unique<Client>(*this, name, numChannels);
+  client->setProcessor(processorFactory(*client), name);
+  printf("Running %s as %s\n", name.c_str(), client->getName().c_str());
+  return client;
+}
+
+std::uint32_t GraphBackend::getSampleRate() const
+{
+  return m_sampleRate;
+}
+
+std::uint32_t GraphBackend::getPeriodSize() const
+{
+  return m_periodSize;
+}
+
+std::size_t GraphBackend::getCaptureChannels() const
+{
+  return m_capture.size();
+}
+
+std::size_t GraphBackend::getPlaybackChannels() const
+{
+  return m_playbackChannels;
+}
+
+void GraphBackend::cycle(const Sample* const* capture, Sample* const* playback)
+{
+  const auto frameTime = static_cast<std::uint32_t>(m_frames);
+
+  // Rounded up, so that the frame time read back is never before the start
+  // of the cycle
+  const auto elapsed = m_frames / m_sampleRate * NanosecondsPerSecond +
+    (m_frames % m_sampleRate * NanosecondsPerSecond + m_sampleRate - 1) / m_sampleRate;
+  m_origin.store(monotonicNow() - elapsed, std::memory_order_relaxed);
+
+  for (auto c = 0U; c < m_capture.size(); ++c)
+  {
+    std::memcpy(m_capture[c].data(), capture[c], sizeof(Sample) * m_periodSize);
+  }
+
+  auto& schedule = *m_schedule.load(std::memory_order_acquire);
+  for (auto& step : schedule.steps)
+  {
+    for (auto& input : step.mixes)
+    {
+      mix(input.sources, input.destination, m_periodSize);
+    }
+    step.runner->process(step.inputs.data(), step.outputs.data(), m_periodSize, frameTime);
+  }
+
+  for (auto c = 0U; c < m_playbackChannels; ++c)
+  {
+    mix(schedule.playback[c], playback[c], m_periodSize);
+  }
+
+  m_frames += m_periodSize;
+  m_cycles.fetch_add(1, std::memory_order_release);
+}
+
+void GraphBackend::promoteToRealtime(int priority)
+{
+  sched_param param{};
+  param.sched_priority = priority;
+  auto error = ::pthread_setschedparam(::pthread_self(), SCHED_FIFO, &param);
+  if (error)
+  {
+    printf("Warning: Could not set SCHED_FIFO priority %d: %s\n", priority, std::strerror(error));
+  }
+}
+
+std::string GraphBackend::nextName(const std::string& name)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return name + "-" + std::to_string(m_opened++);
+}
+
+void GraphBackend::addClient(Client& client)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_clients.push_back(&client);
+  publishSchedule();
+}
+
+void GraphBackend::removeClient(Client& client)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_clients.erase(std::remove(m_clients.begin(), m_clients.end(), &client), m_clients.end());
+
+  auto inputs = client.getInputPorts();
+  auto outputs = client.getOutputPorts();
+  m_connections.erase(std::remove_if(m_connections.begin(), m_connections.end(), [&](const Connection& connection) {
+        return contains(outputs, connection.first) || contains(inputs, connection.second);
+      }), m_connections.end());
+
+  // Returns once the driver no longer runs the client
+  publishSchedule();
+}
+
+bool GraphBackend::connect(const std::vector<std::string>& sources, const std::vector<std::string>& destinations)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  auto sourcePorts = systemPorts("capture", m_capture.size());
+  auto destinationPorts = systemPorts("playback", m_playbackChannels);
+  for (auto client : m_clients)
+  {
+    for (auto& port : client->getOutputPorts())
+    {
+      sourcePorts.push_back(port);
+    }
+    for (auto& port : client->getInputPorts())
+    {
+      destinationPorts.push_back(port);
+    }
+  }
+
+  if (sources.empty() || destinations.empty())
+  {
+    return false;
+  }
+
+  for (auto& source : sources)
+  {
+    if (!contains(sourcePorts, source))
+    {
+      return false;
+    }
+  }
+
+  for (auto& destination : destinations)
+  {
+    if (!contains(destinationPorts, destination))
+    {
+      return false;
+    }
+  }
+
+  for (auto i = 0U; i < std::max(sources.size(), destinations.size()); ++i)
+  {
+    Connection connection{sources[i % sources.size()], destinations[i % destinations.size()]};
+    if (std::find(m_connections.begin(), m_connections.end(), connection) == m_connections.end())
+    {
+      m_connections.push_back(connection);
+    }
+    printf("Connected %s to %s\n", connection.first.c_str(), connection.second.c_str());
+  }
+
+  publishSchedule();
+  return true;
+}
+
+void GraphBackend::disconnect(const std::function<bool(const Connection&)>& matches)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto end = std::remove_if(m_connections.begin(), m_connections.end(), matches);
+  if (end != m_connections.end())
+  {
+    m_connections.erase(end, m_connections.end());
+    publishSchedule();
+  }
+}
+
+std::vector<std::string> GraphBackend::capturePorts() const
+{
+  return systemPorts("capture", m_capture.size());
+}
+
+std::vector<std::string> GraphBackend::playbackPorts() const
+{
+  return systemPorts("playback", m_playbackChannels);
+}
+
+std::uint32_t GraphBackend::getUpcomingFrameTime() const
+{
+  // Extrapolates the current frame from the start of the last cycle, as
+  // jack_frame_time does. The cycle after the current one has not started.
+  const auto elapsed = monotonicNow() - m_origin.load(std::memory_order_relaxed);
+  const auto frames = elapsed / NanosecondsPerSecond * m_sampleRate +
+    elapsed % NanosecondsPerSecond * m_sampleRate / NanosecondsPerSecond;
+  return static_cast<std::uint32_t>(frames) + m_periodSize;
+}
+
+void GraphBackend::publishSchedule()
+{
+  auto schedule = std::make_unique<Schedule>();
+
+  // Where the signal of every source port is, and which client makes it
+  std::map<std::string, Sample*> signals;
+  std::map<std::string, std::size_t> owners;
+  auto capture = capturePorts();
+  for (auto c = 0U; c < capture.size(); ++c)
+  {
+    signals[capture[c]] = m_capture[c].data();
+  }
+  for (auto i = 0U; i < m_clients.size(); ++i)
+  {
+    auto outputs = m_clients[i]->getOutputPorts();
+    for (auto c = 0U; c < outputs.size(); ++c)
+    {
+      signals[outputs[c]] = m_clients[i]->getOutputBuffer(c);
+      owners[outputs[c]] = i;
+    }
+  }
+
+  std::map<std::string, std::vector<std::string>> feeds;
+  for (auto& connection : m_connections)
+  {
+    feeds[connection.second].push_back(connection.first);
+  }
+
+  // A client runs after the clients feeding it, otherwise in the order the
+  // clients were created. The clients in a feedback loop run in creation
+  // order, reading the outputs of the previous period.
+  std::vector<std::vector<std::size_t>> dependencies(m_clients.size());
+  for (auto i = 0U; i < m_clients.size(); ++i)
+  {
+    for (auto& port : m_clients[i]->getInputPorts())
+    {
+      for (auto& source : feeds[port])
+      {
+        auto owner = owners.find(source);
+        if (owner != owners.end() && owner->second != i)
+        {
+          dependencies[i].push_back(owner->second);
+        }
+      }
+    }
+  }
+
+  std::vector<std::size_t> order;
+  std::vector<bool> scheduled(m_clients.size(), false);
+  while (order.size() < m_clients.size())
+  {
+    auto progress = false;
+    for (auto i = 0U; i < m_clients.size(); ++i)
+    {
+      auto ready = std::all_of(dependencies[i].begin(), dependencies[i].end(), [&](auto d) { return scheduled[d]; });
+      if (!scheduled[i] && ready)
+      {
+        order.push_back(i);
+        scheduled[i] = progress = true;
+      }
+    }
+
+    if (!progress)
+    {
+      auto next = std::find(scheduled.begin(), scheduled.end(), false) - scheduled.begin();
+      order.push_back(next);
+      scheduled[next] = true;
+    }
+  }
+
+  for (auto i : order)
+  {
+    auto& client = *m_clients[i];
+    auto inputs = client.getInputPorts();
+
+    Schedule::Step step;
+    step.runner = &client.getRunner();
+    for (auto c = 0U; c < inputs.size(); ++c)
+    {
+      auto& sources = feeds[inputs[c]];
+      if (sources.size() == 1)
+      {
+        step.inputs.push_back(signals[sources[0]]);
+      }
+      else
+      {
+        Schedule::Mix input{client.getInputBuffer(c), {}};
+        for (auto& source : sources)
+        {
+          input.sources.push_back(signals[source]);
+        }
+        step.mixes.push_back(input);
+        step.inputs.push_back(client.getInputBuffer(c));
+      }
+      step.outputs.push_back(client.getOutputBuffer(c));
+    }
+    schedule->steps.push_back(std::move(step));
+  }
+
+  for (auto& port : playbackPorts())
+  {
+    std::vector<Sample*> sources;
+    for (auto& source : feeds[port])
+    {
+      sources.push_back(signals[source]);
+    }
+    schedule->playback.push_back(sources);
+  }
+
+  auto cycles = m_cycles.load(std::memory_order_acquire);
+  m_retired.erase(
+      std::remove_if(m_retired.begin(), m_retired.end(), [cycles](auto& retired) { return retired.second != cycles; }),
+      m_retired.end());
+
+  auto previous = std::exchange(m_published, std::move(schedule));
+  m_schedule.store(m_published.get(), std::memory_order_release);
+
+  cycles = m_cycles.load(std::memory_order_acquire);
+  if (previous && !waitForCycle())
+  {
+    // The driver may be stalled halfway through the previous schedule
+    m_retired.emplace_back(std::move(previous), cycles);
+  }
+}
+
+bool GraphBackend::waitForCycle() const
+{
+  // The driver loads the schedule once per cycle, so a cycle completing
+  // after it was swapped means the previous one is no longer in use
+  auto cycles = m_cycles.load(std::memory_order_acquire);
+  auto deadline = std::chrono::steady_clock::now() + CycleTimeout;
+  while (m_cycles.load(std::memory_order_acquire) == cycles)
+  {
+    if (std::chrono::steady_clock::now() > deadline)
+    {
+      printf("Warning: No process cycle within timeout\n");
+      return false;
+    }
+    std::this_thread::sleep_for(std::chrono::microseconds(500));
+  }
+  return true;
+}
@@ -0,0 +1,88 @@
+#include <instance_batch.h>
+#include <algorithm>
+
+using namespace awesomefx;
+
+InstanceBatch::InstanceBatch(const FxPlugin& plugin, const AudioProcessingContext& context, std::size_t numChannels)
+{
+  for (auto i = 0U; i < (numChannels + 1) / 2; ++i)
+  {
+    m_instances.push_back(plugin.createAudioProcessor(context));
+  }
+}
+
+void InstanceBatch::process(Sample* in_l, Sample* in_r, Sample* out_l, Sample* out_r, std::size_t numSamples)
+{
+  const Sample* in[] = { in_l, in_r };
+  Sample* out[] = { out_l, out_r };
+  processChannels(in, out, 2, numSamples);
+}
+
+void InstanceBatch::processChannels(const Sample* const* in, Sample* const* out, std::size_t numChannels, std::size_t numSamples)
+{
+  numChannels = std::min(numChannels, 2 * m_instances.size());
+
+  // Processors take mutable inputs but do not write them
+  for (auto c = 0U; c + 1 < numChannels; c += 2)
+  {
+    m_instances[c / 2]->process(
+        const_cast<Sample*>(in[c]),
+        const_cast<Sample*>(in[c + 1]),
+        out[c],
+        out[c + 1],
+        numSamples);
+  }
+
+  if (numChannels % 2)
+  {
+    auto c = numChannels - 1;
+    for (auto offset = 0U; offset < numSamples; offset += m_discard.size())
+    {
+      auto chunk = std::min(m_discard.size(), numSamples - offset);
+      auto input = const_cast<Sample*>(in[c] + offset);
+      m_instances[c / 2]->process(input, input, out[c] + offset, m_discard.data(), chunk);
+    }
+  }
+}
+
+void InstanceBatch::setParameter(const Parameter& param)
+{
+  for (auto& instance : m_instances)
+  {
+    instance->setParameter(param);
+  }
+}
+
+// The instances are identical, so the first one prepares for all of them
+bool InstanceBatch::prepareParameter(const Parameter& param, PreparedParameter& prepared) const
+{
+  return m_instances.front()->prepareParameter(param, prepared);
+}
+
+void InstanceBatch::applyParameter(const PreparedParameter& prepared)
+{
+  for (auto& instance : m_instances)
+  {
+    instance->applyParameter(prepared);
+  }
+}
+
+std::uint32_t InstanceBatch::getLatency() const
+{
+  return m_instances.front()->getLatency();
+}
+
+AudioProcessor::Ptr awesomefx::createSlotProcessor(const FxPlugin& plugin, const AudioProcessingContext& context, std::size_t numChannels)
+{
+  if (numChannels == 2)
+  {
+    return plugin.createAudioProcessor(context);
+  }
+
+  auto batch = plugin.createBatchProcessor(context, numChannels);
+  if (batch)
+  {
+    return batch;
+  }
+  return std::make_unique<InstanceBatch>(plugin, context, numChannels);
+}
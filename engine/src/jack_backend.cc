@@ -0,0 +1,13 @@
+#include <jack_backend.h>
+
+using namespace awesomefx;
+
+JackBackend::JackBackend(const std::string& prefix, std::size_t poolSize)
+  : m_pool(prefix, poolSize)
+{
+}
+
+AudioClient::Ptr JackBackend::createClient(const std::string& name, const AudioProcessor::Factory& processorFactory, std::size_t numChannels)
+{
+  return m_pool.create(name, processorFactory, numChannels);
+}
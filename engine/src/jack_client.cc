@@ -1,46 +1,110 @@
 #include <jack_client.h>
+#include <algorithm>
 #include <stdexcept>
+#include <string>
 #include <cstdio>
 #include <memory>
+#include <utility>
 
 using namespace awesomefx;
 
 namespace
 {
 
-const std::size_t RingBufferSize = 8192;
+// Stereo slots keep the names they always had
+std::string portName(const char* direction, std::size_t channel, std::size_t numChannels)
+{
+  if (numChannels == 2)
+  {
+    return std::string(direction) + (channel == 0 ? "_left" : "_right");
+  }
+  return std::string(direction) + "_" + std::to_string(channel + 1);
+}
 
 int process(jack_nframes_t nframes, void *arg)
 {
   auto& data = *static_cast<JackClientImpl::ProcessCtx*>(arg);
+  auto& in = data.inputBuffers;
+  auto& out = data.outputBuffers;
 
-  if (::jack_ringbuffer_read_space(data.ringBuffer) >= sizeof(AudioProcessor::Parameter))
+  for (auto c = 0U; c < out.size(); ++c)
   {
-    AudioProcessor::Parameter parameter;
-    auto size = ::jack_ringbuffer_read(
-        data.ringBuffer,
-        reinterpret_cast<char *>(&parameter),
-        sizeof(parameter));
-
-    if (size == sizeof(parameter))
-    {
-      data.processor->setParameter(parameter);
-    }
+    in[c] = static_cast<Sample *>(::jack_port_get_buffer(data.inputPorts[c], nframes));
+    out[c] = static_cast<Sample *>(::jack_port_get_buffer(data.outputPorts[c], nframes));
   }
 
-  data.processor->process(
-      static_cast<Sample *>(::jack_port_get_buffer(data.inputPorts.left, nframes)),
-      static_cast<Sample *>(::jack_port_get_buffer(data.inputPorts.right, nframes)),
-      static_cast<Sample *>(::jack_port_get_buffer(data.outputPorts.left, nframes)),
-      static_cast<Sample *>(::jack_port_get_buffer(data.outputPorts.right, nframes)),
-      nframes);
+  data.runner->process(in.data(), out.data(), nframes, ::jack_last_frame_time(data.client));
 
   return 0;
 }
+
+// Each output lags its input by the processor latency. Runs on a JACK
+// thread whenever the graph's latencies are recomputed.
+void latency(jack_latency_callback_mode_t mode, void *arg)
+{
+  auto& data = *static_cast<JackClientImpl::ProcessCtx*>(arg);
+  auto latency = data.runner->getLatency();
+
+  for (auto c = 0U; c < data.inputPorts.size(); ++c)
+  {
+    // Capture latency flows downstream, playback latency upstream
+    auto from = mode == JackCaptureLatency ? data.inputPorts[c] : data.outputPorts[c];
+    auto to = mode == JackCaptureLatency ? data.outputPorts[c] : data.inputPorts[c];
+
+    jack_latency_range_t range;
+    ::jack_port_get_latency_range(from, mode, &range);
+    range.min += latency;
+    range.max += latency;
+    ::jack_port_set_latency_range(to, mode, &range);
+  }
+}
+
+// Pairs the ports up over the longer side, repeating the shorter one, so
+// that a stereo source feeds every channel of a batch slot and every channel
+// of a batch slot sums into stereo. Every port that is not connected makes
+// the result nonzero.
+int connectPorts(jack_client_t* client, const std::vector<std::string>& sources, const std::vector<std::string>& destinations)
+{
+  if (sources.empty() || destinations.empty())
+  {
+    return 1;
+  }
+
+  auto failed = 0;
+  for (auto i = 0U; i < std::max(sources.size(), destinations.size()); ++i)
+  {
+    auto& source = sources[i % sources.size()];
+    auto& destination = destinations[i % destinations.size()];
+    failed |= ::jack_connect(client, source.c_str(), destination.c_str());
+    printf("Connected %s to %s\n", source.c_str(), destination.c_str());
+  }
+  return failed;
+}
+
+std::vector<std::string> portNames(const std::vector<jack_port_t*>& ports)
+{
+  std::vector<std::string> names;
+  for (auto port : ports)
+  {
+    names.push_back(::jack_port_name(port));
+  }
+  return names;
+}
+}
+
+JackClientImpl::JackClientImpl(const std::string& name, const AudioProcessor::Factory& processorFactory, std::size_t numChannels)
+  : JackClientImpl(name, numChannels)
+{
+  setProcessor(processorFactory(*this), name);
 }
 
-JackClientImpl::JackClientImpl(const std::string& name, const AudioProcessor::Factory& processorFactory)
+JackClientImpl::JackClientImpl(const std::string& name, std::size_t numChannels)
 {
+  if (numChannels == 0)
+  {
+    throw std::runtime_error("A client needs at least one channel");
+  }
+
   jack_status_t status;
   m_client = ::jack_client_open(name.c_str(), JackNullOption, &status, 0);
 
@@ -49,23 +113,28 @@ JackClientImpl::JackClientImpl(const std::string& name, const AudioProcessor::Fa
     throw std::runtime_error("jack_client_open failed");
   }
 
-  m_processCtx.ringBuffer = ::jack_ringbuffer_create(RingBufferSize);
-  m_processCtx.processor = processorFactory(*this);
+  m_processCtx.client = m_client;
+  m_processCtx.runner = std::make_unique<ProcessorRunner>(getSampleRate(), numChannels);
 
   ::jack_set_process_callback(m_client, process, &m_processCtx);
+  ::jack_set_latency_callback(m_client, latency, &m_processCtx);
 
-  auto in_left = ::jack_port_register (m_client, "in_left", JACK_DEFAULT_AUDIO_TYPE, JackPortIsInput, 0);
-  auto in_right = ::jack_port_register (m_client, "in_right", JACK_DEFAULT_AUDIO_TYPE, JackPortIsInput, 0);
-  auto out_left = ::jack_port_register (m_client, "out_left", JACK_DEFAULT_AUDIO_TYPE, JackPortIsOutput, 0);
-  auto out_right = ::jack_port_register (m_client, "out_right", JACK_DEFAULT_AUDIO_TYPE, JackPortIsOutput, 0);
-
-  if (!in_left || !in_right || !out_left || !out_right)
+  for (auto c = 0U; c < numChannels; ++c)
   {
-    throw std::runtime_error("Failed to create ports");
+    auto in = ::jack_port_register (m_client, portName("in", c, numChannels).c_str(), JACK_DEFAULT_AUDIO_TYPE, JackPortIsInput, 0);
+    auto out = ::jack_port_register (m_client, portName("out", c, numChannels).c_str(), JACK_DEFAULT_AUDIO_TYPE, JackPortIsOutput, 0);
+
+    if (!in || !out)
+    {
+      throw std::runtime_error("Failed to create ports");
+    }
+
+    m_processCtx.inputPorts.push_back(in);
+    m_processCtx.outputPorts.push_back(out);
   }
 
-  m_processCtx.inputPorts = { in_left, in_right };
-  m_processCtx.outputPorts = { out_left, out_right };
+  m_processCtx.inputBuffers.resize(numChannels);
+  m_processCtx.outputBuffers.resize(numChannels);
 
   if (::jack_activate(m_client))
   {
@@ -78,6 +147,31 @@ JackClientImpl::~JackClientImpl()
   ::jack_client_close(m_client);
 }
 
+void JackClientImpl::setProcessor(AudioProcessor::Ptr processor, const std::string& name)
+{
+  auto previousLatency = m_processCtx.runner->getLatency();
+  m_processCtx.runner->setProcessor(std::move(processor), name);
+
+  if (m_processCtx.runner->getLatency() != previousLatency)
+  {
+    ::jack_recompute_total_latencies(m_client);
+  }
+}
+
+void JackClientImpl::reset() const
+{
+  m_processCtx.runner->reset();
+}
+
+void JackClientImpl::disconnectAll() const
+{
+  disconnectInputs();
+  for (auto port : m_processCtx.outputPorts)
+  {
+    ::jack_port_disconnect(m_client, port);
+  }
+}
+
 void JackClientImpl::connectInputsToCapturePorts(std::vector<std::string> portNames, bool mono) const
 {
   if (portNames.empty())
@@ -101,20 +195,12 @@ void JackClientImpl::connectInputsToCapturePorts(std::vector<std::string> portNa
     throw std::runtime_error("There must be at least one capture port");
   }
 
-  auto left = portNames[0];
-  auto right = mono || portNames.size() < 2 ? portNames[0] : portNames[1];
-
-  auto res1 = ::jack_connect(
-      m_client,
-      left.c_str(),
-      ::jack_port_name(m_processCtx.inputPorts.left));
-
-  auto res2 = ::jack_connect(
-      m_client,
-      right.c_str(),
-      ::jack_port_name(m_processCtx.inputPorts.right));
+  if (mono)
+  {
+    portNames.resize(1);
+  }
 
-  if (res1 || res2)
+  if (connectPorts(m_client, portNames, getInputPorts()))
   {
     throw std::runtime_error("Failed to connect input to capture ports");
   }
@@ -122,37 +208,17 @@ void JackClientImpl::connectInputsToCapturePorts(std::vector<std::string> portNa
 
 std::vector<std::string> JackClientImpl::getInputPorts() const
 {
-  auto& ports = m_processCtx.inputPorts;
-  return { ::jack_port_name(ports.left), ::jack_port_name(ports.right) };
+  return portNames(m_processCtx.inputPorts);
 }
 
 std::vector<std::string> JackClientImpl::getOutputPorts() const
 {
-  auto& ports = m_processCtx.outputPorts;
-  return { ::jack_port_name(ports.left), ::jack_port_name(ports.right) };
+  return portNames(m_processCtx.outputPorts);
 }
 
 void JackClientImpl::connectInputs(const std::vector<std::string>& portNames) const
 {
-  auto res1 = ::jack_connect(
-      m_client,
-      portNames[0].c_str(),
-      ::jack_port_name(m_processCtx.inputPorts.left));
-
-  auto res2 = ::jack_connect(
-      m_client,
-      portNames[1].c_str(),
-      ::jack_port_name(m_processCtx.inputPorts.right));
-
-  printf("Connected ins %s and %s to %s and %s\n",
-      ::jack_port_name(m_processCtx.inputPorts.left),
-      ::jack_port_name(m_processCtx.inputPorts.right),
-      portNames[0].c_str(),
-      portNames[1].c_str()
-      );
-
-
-  if (res1 || res2)
+  if (connectPorts(m_client, portNames, getInputPorts()))
   {
     throw std::runtime_error("Failed to connect input ports");
   }
@@ -160,24 +226,7 @@ void JackClientImpl::connectInputs(const std::vector<std::string>& portNames) co
 
 void JackClientImpl::connectOutputs(const std::vector<std::string>& portNames) const
 {
-  auto res1 = ::jack_connect(
-      m_client,
-      ::jack_port_name(m_processCtx.outputPorts.left),
-      portNames[0].c_str());
-
-  auto res2 = ::jack_connect(
-      m_client,
-      ::jack_port_name(m_processCtx.outputPorts.right),
-      portNames[1].c_str());
-
-  printf("Connected outs %s and %s to %s and %s\n",
-      ::jack_port_name(m_processCtx.outputPorts.left),
-      ::jack_port_name(m_processCtx.outputPorts.right),
-      portNames[0].c_str(),
-      portNames[1].c_str()
-      );
-
-  if (res1 || res2)
+  if (connectPorts(m_client, getOutputPorts(), portNames))
   {
     throw std::runtime_error("Failed to connect output ports");
   }
@@ -204,40 +253,107 @@ void JackClientImpl::connectOutputsToPlaybackPorts() const
     throw std::runtime_error("There must be at least 2 physical playback ports");
   }
 
-  auto res1 = ::jack_connect(
-      m_client,
-      ::jack_port_name(m_processCtx.outputPorts.left),
-      portNames[0].c_str());
-
-  auto res2 = ::jack_connect(
-      m_client,
-      ::jack_port_name(m_processCtx.outputPorts.right),
-      portNames[1].c_str());
+  // A slot of any width goes round the first two
+  portNames.resize(2);
 
-  printf("Connected %s and %s\n",
-      ::jack_port_name(m_processCtx.outputPorts.left),
-      ::jack_port_name(m_processCtx.outputPorts.right)
-      );
-  if (res1 || res2)
+  if (connectPorts(m_client, getOutputPorts(), portNames))
   {
     throw std::runtime_error("Failed to connect output ports to playback ports");
   }
 }
 
-void JackClientImpl::setParameter(const AudioProcessor::Parameter& parameter) const
+void JackClientImpl::disconnectInputs() const
 {
-  auto size = ::jack_ringbuffer_write(
-      m_processCtx.ringBuffer,
-      reinterpret_cast<const char *>(&parameter),
-      sizeof(parameter));
+  for (auto port : m_processCtx.inputPorts)
+  {
+    ::jack_port_disconnect(m_client, port);
+  }
+}
 
-  if (size != sizeof(parameter))
+void JackClientImpl::disconnectOutputsFromPlaybackPorts() const
+{
+  auto ports = ::jack_get_ports (m_client, 0, 0, JackPortIsPhysical|JackPortIsInput);
+  if (ports == nullptr)
   {
-    throw std::runtime_error("Failed to write parameter to ringbuffer");
+    return;
   }
+
+  for (auto i = 0U; ports[i]; ++i)
+  {
+    for (auto port : m_processCtx.outputPorts)
+    {
+      ::jack_disconnect(m_client, ::jack_port_name(port), ports[i]);
+    }
+  }
+
+  ::jack_free(ports);
+}
+
+void JackClientImpl::setParameter(const AudioProcessor::Parameter& parameter) const
+{
+  writeMessage(parameter, nullptr, 0);
+}
+
+void JackClientImpl::setParameter(const AudioProcessor::Parameter& parameter, const ParameterBatch& batch) const
+{
+  writeMessage(parameter, batch.gate, batch.id);
+}
+
+void JackClientImpl::writeMessage(const AudioProcessor::Parameter& parameter, const ParameterBatchGate* gate, std::uint32_t batch) const
+{
+  // Due one period after it arrives, which is the earliest cycle that can
+  // still apply every message on time. Timing jitter is then that of the
+  // control thread, not the period size.
+  m_processCtx.runner->writeMessage(parameter, gate, batch, getUpcomingFrameTime());
+}
+
+std::uint32_t JackClientImpl::getLatency() const
+{
+  return m_processCtx.runner->getLatency();
+}
+
+bool JackClientImpl::preservesMono() const
+{
+  return m_processCtx.runner->preservesMono();
+}
+
+void JackClientImpl::setMonoInput(bool mono) const
+{
+  m_processCtx.runner->setMonoInput(mono);
+}
+
+std::uint32_t JackClientImpl::getUpcomingFrameTime() const
+{
+  // Cycles that have started did so at or before the current frame time
+  return ::jack_frame_time(m_client) + ::jack_get_buffer_size(m_client);
+}
+
+LevelMeter::Levels JackClientImpl::readLevels() const
+{
+  return m_processCtx.runner->readLevels();
+}
+
+void JackClientImpl::startTrace() const
+{
+  m_processCtx.runner->startTrace();
+}
+
+void JackClientImpl::stopTrace() const
+{
+  m_processCtx.runner->stopTrace();
+}
+
+std::vector<TraceBuffer::Event> JackClientImpl::readTrace(std::chrono::steady_clock::time_point deadline) const
+{
+  return m_processCtx.runner->readTrace(deadline);
 }
 
 std::uint32_t JackClientImpl::getSampleRate() const
 {
   return ::jack_get_sample_rate(m_client);
 }
+
+std::size_t JackClientImpl::getNumChannels() const
+{
+  return m_processCtx.outputPorts.size();
+}
@@ -0,0 +1,178 @@
+#include <jack_client_pool.h>
+#include <cstdio>
+
+using namespace awesomefx;
+
+class JackClientPool::PooledJackClient : public AudioClient
+{
+  public:
+    PooledJackClient(JackClientPool& pool, std::unique_ptr<JackClientImpl> client)
+      : m_pool(pool)
+      , m_client(std::move(client))
+    {
+    }
+
+    ~PooledJackClient() override
+    {
+      m_client->setProcessor(nullptr);
+      m_client->reset();
+      m_client->setMonoInput(false);
+      m_client->disconnectAll();
+      m_pool.release(std::move(m_client));
+    }
+
+    void connectInputsToCapturePorts(std::vector<std::string> portNames, bool mono) const override
+    {
+      m_client->connectInputsToCapturePorts(std::move(portNames), mono);
+    }
+
+    void connectOutputsToPlaybackPorts() const override
+    {
+      m_client->connectOutputsToPlaybackPorts();
+    }
+
+    std::vector<std::string> getInputPorts() const override
+    {
+      return m_client->getInputPorts();
+    }
+
+    std::vector<std::string> getOutputPorts() const override
+    {
+      return m_client->getOutputPorts();
+    }
+
+    void connectInputs(const std::vector<std::string>& portNames) const override
+    {
+      m_client->connectInputs(portNames);
+    }
+
+    void connectOutputs(const std::vector<std::string>& portNames) const override
+    {
+      m_client->connectOutputs(portNames);
+    }
+
+    void disconnectInputs() const override
+    {
+      m_client->disconnectInputs();
+    }
+
+    void disconnectOutputsFromPlaybackPorts() const override
+    {
+      m_client->disconnectOutputsFromPlaybackPorts();
+    }
+
+    void setParameter(const AudioProcessor::Parameter& parameter) const override
+    {
+      m_client->setParameter(parameter);
+    }
+
+    void setParameter(const AudioProcessor::Parameter& parameter, const ParameterBatch& batch) const override
+    {
+      m_client->setParameter(parameter, batch);
+    }
+
+    std::uint32_t getLatency() const override
+    {
+      return m_client->getLatency();
+    }
+
+    bool preservesMono() const override
+    {
+      return m_client->preservesMono();
+    }
+
+    void setMonoInput(bool mono) const override
+    {
+      m_client->setMonoInput(mono);
+    }
+
+    std::uint32_t getUpcomingFrameTime() const override
+    {
+      return m_client->getUpcomingFrameTime();
+    }
+
+    LevelMeter::Levels readLevels() const override
+    {
+      return m_client->readLevels();
+    }
+
+    void startTrace() const override
+    {
+      m_client->startTrace();
+    }
+
+    void stopTrace() const override
+    {
+      m_client->stopTrace();
+    }
+
+    std::vector<TraceBuffer::Event> readTrace(std::chrono::steady_clock::time_point deadline) const override
+    {
+      return m_client->readTrace(deadline);
+    }
+
+  private:
+    JackClientPool& m_pool;
+    std::unique_ptr<JackClientImpl> m_client;
+};
+
+JackClientPool::JackClientPool(const std::string& prefix, std::size_t size)
+  : m_prefix(prefix)
+{
+  for (auto i = 0U; i < size; ++i)
+  {
+    release(acquire());
+  }
+}
+
+AudioClient::Ptr JackClientPool::create(const std::string& name, const AudioProcessor::Factory& processorFactory, std::size_t numChannels)
+{
+  if (numChannels != 2)
+  {
+    auto client = std::make_unique<JackClientImpl>(nextName(), numChannels);
+    client->setProcessor(processorFactory(*client), name);
+    printf("Running %s on %zu channels\n", name.c_str(), numChannels);
+    return client;
+  }
+
+  auto client = acquire();
+  try
+  {
+    client->setProcessor(processorFactory(*client), name);
+  }
+  catch (...)
+  {
+    release(std::move(client));
+    throw;
+  }
+  printf("Running %s on a pooled client\n", name.c_str());
+
+  return std::make_unique<PooledJackClient>(*this, std::move(client));
+}
+
+std::unique_ptr<JackClientImpl> JackClientPool::acquire()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_idle.empty())
+    {
+      auto client = std::move(m_idle.back());
+      m_idle.pop_back();
+      return client;
+    }
+  }
+
+  return std::make_unique<JackClientImpl>(nextName());
+}
+
+std::string JackClientPool::nextName()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_prefix + "-" + std::to_string(m_opened++);
+}
+
+void JackClientPool::release(std::unique_ptr<JackClientImpl> client)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_idle.push_back(std::move(client));
+}
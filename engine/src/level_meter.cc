@@ -0,0 +1,128 @@
+#include <level_meter.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace awesomefx;
+
+namespace
+{
+
+const std::size_t MaxQueuedFrames = 64;
+
+using Vec4 = float __attribute__((vector_size(16)));
+
+inline Vec4 load(const Sample* p)
+{
+  Vec4 v;
+  std::memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+// Folds the absolute peak and the sum of squares of a block into peak and power
+void accumulate(const Sample* x, std::size_t n, float& peak, float& power)
+{
+  Vec4 zero{};
+  Vec4 vpeak{};
+  Vec4 vpower{};
+
+  auto i = 0U;
+  for (; i + 4 <= n; i += 4)
+  {
+    auto v = load(x + i);
+    auto a = v < zero ? -v : v;
+    vpeak = a > vpeak ? a : vpeak;
+    vpower += v * v;
+  }
+
+  auto p = std::max(std::max(vpeak[0], vpeak[1]), std::max(vpeak[2], vpeak[3]));
+  auto e = (vpower[0] + vpower[1]) + (vpower[2] + vpower[3]);
+
+  for (; i < n; ++i)
+  {
+    p = std::max(p, std::fabs(x[i]));
+    e += x[i] * x[i];
+  }
+
+  peak = std::max(peak, p);
+  power += e;
+}
+
+}
+
+LevelMeter::LevelMeter(std::uint32_t sampleRate)
+  : m_frames(::jack_ringbuffer_create(MaxQueuedFrames * sizeof(Levels)))
+  , m_window(std::max(1U, sampleRate / FramesPerSecond))
+{
+}
+
+LevelMeter::~LevelMeter()
+{
+  ::jack_ringbuffer_free(m_frames);
+}
+
+void LevelMeter::process(const Sample* left, const Sample* right, std::size_t numSamples)
+{
+  accumulate(left, numSamples, m_peak[0], m_power[0]);
+  accumulate(right, numSamples, m_peak[1], m_power[1]);
+
+  m_count += numSamples;
+  if (m_count < m_window)
+  {
+    return;
+  }
+
+  Levels levels
+  {
+    m_peak[0],
+    m_peak[1],
+    std::sqrt(m_power[0] / m_count),
+    std::sqrt(m_power[1] / m_count)
+  };
+
+  // Nobody listening, drop the frame
+  if (::jack_ringbuffer_write_space(m_frames) >= sizeof(levels))
+  {
+    ::jack_ringbuffer_write(m_frames, reinterpret_cast<const char *>(&levels), sizeof(levels));
+  }
+
+  m_count = 0;
+  m_peak[0] = m_peak[1] = 0;
+  m_power[0] = m_power[1] = 0;
+}
+
+void LevelMeter::reset()
+{
+  ::jack_ringbuffer_read_advance(m_frames, ::jack_ringbuffer_read_space(m_frames));
+  m_count = 0;
+  m_peak[0] = m_peak[1] = 0;
+  m_power[0] = m_power[1] = 0;
+  m_last = {};
+}
+
+LevelMeter::Levels LevelMeter::read()
+{
+  Levels result{};
+  Levels levels;
+  auto frames = 0U;
+
+  while (::jack_ringbuffer_read(
+        m_frames,
+        reinterpret_cast<char *>(&levels),
+        sizeof(levels)) == sizeof(levels))
+  {
+    result.peakLeft = std::max(result.peakLeft, levels.peakLeft);
+    result.peakRight = std::max(result.peakRight, levels.peakRight);
+    result.rmsLeft = levels.rmsLeft;
+    result.rmsRight = levels.rmsRight;
+    ++frames;
+  }
+
+  // Polled faster than frames are produced, repeat the last reading
+  if (frames > 0)
+  {
+    m_last = result;
+  }
+
+  return m_last;
+}
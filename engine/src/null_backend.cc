@@ -0,0 +1,125 @@
+#include <null_backend.h>
+#include <algorithm>
+#include <ctime>
+#include <random>
+
+using namespace awesomefx;
+
+namespace
+{
+
+const long NanosecondsPerSecond = 1000000000;
+
+// About -20 dBFS RMS
+const float NoiseLevel = 0.17;
+
+void advance(timespec& time, long nanoseconds)
+{
+  time.tv_nsec += nanoseconds;
+  while (time.tv_nsec >= NanosecondsPerSecond)
+  {
+    time.tv_nsec -= NanosecondsPerSecond;
+    ++time.tv_sec;
+  }
+}
+
+bool isBefore(const timespec& a, const timespec& b)
+{
+  return a.tv_sec < b.tv_sec || (a.tv_sec == b.tv_sec && a.tv_nsec < b.tv_nsec);
+}
+
+long difference(const timespec& from, const timespec& to)
+{
+  return (to.tv_sec - from.tv_sec) * NanosecondsPerSecond + (to.tv_nsec - from.tv_nsec);
+}
+}
+
+NullBackend::NullBackend(const Settings& settings)
+  : GraphBackend(settings.sampleRate, settings.periodSize, settings.channels, settings.channels)
+  , m_capture(settings.channels, std::vector<Sample>(settings.periodSize))
+  , m_playback(settings.channels, std::vector<Sample>(settings.periodSize))
+  , m_cycleTimes(HistogramResolution * HistogramPeriods + 1)
+{
+  if (settings.noise)
+  {
+    // The same noise every period, generating it would count as load
+    std::mt19937 generator;
+    std::normal_distribution<Sample> distribution(0, NoiseLevel);
+    for (auto& buffer : m_capture)
+    {
+      std::generate(buffer.begin(), buffer.end(), [&] { return distribution(generator); });
+    }
+  }
+
+  m_thread = std::thread([this, priority = settings.priority] { run(priority); });
+}
+
+NullBackend::~NullBackend()
+{
+  m_running = false;
+  m_thread.join();
+}
+
+std::uint32_t NullBackend::getOverruns() const
+{
+  return m_overruns.load(std::memory_order_relaxed);
+}
+
+std::vector<std::uint32_t> NullBackend::readCycleTimes() const
+{
+  std::vector<std::uint32_t> cycleTimes;
+  for (auto& bin : m_cycleTimes)
+  {
+    cycleTimes.push_back(bin.load(std::memory_order_relaxed));
+  }
+  return cycleTimes;
+}
+
+void NullBackend::run(int priority)
+{
+  if (priority > 0)
+  {
+    promoteToRealtime(priority);
+  }
+
+  std::vector<const Sample*> capture;
+  std::vector<Sample*> playback;
+  for (auto c = 0U; c < m_capture.size(); ++c)
+  {
+    capture.push_back(m_capture[c].data());
+    playback.push_back(m_playback[c].data());
+  }
+
+  const auto period = static_cast<long>(static_cast<double>(getPeriodSize()) * NanosecondsPerSecond / getSampleRate());
+
+  // Absolute deadlines, so that the time spent in a cycle does not add up
+  timespec deadline;
+  ::clock_gettime(CLOCK_MONOTONIC, &deadline);
+
+  while (m_running.load(std::memory_order_relaxed))
+  {
+    timespec start;
+    ::clock_gettime(CLOCK_MONOTONIC, &start);
+
+    cycle(capture.data(), playback.data());
+
+    timespec now;
+    ::clock_gettime(CLOCK_MONOTONIC, &now);
+    auto bin = std::min<std::size_t>(difference(start, now) * HistogramResolution / period, m_cycleTimes.size() - 1);
+    m_cycleTimes[bin].fetch_add(1, std::memory_order_relaxed);
+
+    advance(deadline, period);
+
+    // A whole period behind, start over from now rather than catching up
+    auto late = deadline;
+    advance(late, period);
+    if (isBefore(late, now))
+    {
+      m_overruns.fetch_add(1, std::memory_order_relaxed);
+      deadline = now;
+      continue;
+    }
+
+    ::clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, nullptr);
+  }
+}
@@ -0,0 +1,318 @@
+#include <processor_runner.h>
+#include <rt_sanitizer.h>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdio>
+#include <cstring>
+#include <chrono>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+using namespace awesomefx;
+
+namespace
+{
+
+// Messages carry prepared payloads, this holds a few hundred of them
+const std::size_t RingBufferSize = 32768;
+const auto CycleTimeout = std::chrono::seconds(1);
+
+// Parameter events split the cycle where they are due, but never into
+// pieces shorter than this. Events due sooner are applied early.
+const std::uint32_t MinSubBlock = 32;
+
+}
+
+ProcessorRunner::ProcessorRunner(std::uint32_t sampleRate, std::size_t numChannels)
+  : m_ringBuffer(::jack_ringbuffer_create(RingBufferSize))
+  , m_meter(sampleRate)
+  , m_inputs(numChannels)
+  , m_outputs(numChannels)
+{
+  if (numChannels == 0)
+  {
+    throw std::runtime_error("A client needs at least one channel");
+  }
+}
+
+ProcessorRunner::~ProcessorRunner()
+{
+  ::jack_ringbuffer_free(m_ringBuffer);
+}
+
+void ProcessorRunner::process(Sample* const* in, Sample* const* out, std::uint32_t numSamples, std::uint32_t cycleStart)
+{
+  auto processor = m_active.load(std::memory_order_acquire);
+  const auto numChannels = m_outputs.size();
+
+  m_trace.begin("cycle");
+
+  if (processor)
+  {
+    std::copy(in, in + numChannels, m_inputs.begin());
+    std::copy(out, out + numChannels, m_outputs.begin());
+
+    // Runs up to each parameter event that is due within the cycle, so that
+    // automation lands on its frame rather than on the period boundary
+    std::uint32_t done = 0;
+    while (done < numSamples)
+    {
+      std::uint32_t next;
+      auto until = cycleStart + std::min(done + MinSubBlock, numSamples);
+      auto length = numSamples - done;
+      if (applyParameters(*processor, cycleStart, until, next))
+      {
+        length = std::min(length, next - (cycleStart + done));
+      }
+
+      processBlock(*processor, length);
+
+      for (auto c = 0U; c < numChannels; ++c)
+      {
+        m_inputs[c] += length;
+        m_outputs[c] += length;
+      }
+      done += length;
+    }
+
+    // Batch slots are metered on their first two channels
+    m_meter.process(out[0], out[std::min<std::size_t>(1, numChannels - 1)], numSamples);
+  }
+  else
+  {
+    // Idle client, drop whatever was left for the previous processor
+    ::jack_ringbuffer_read_advance(m_ringBuffer, ::jack_ringbuffer_read_space(m_ringBuffer));
+    for (auto c = 0U; c < numChannels; ++c)
+    {
+      std::memset(out[c], 0, sizeof(Sample) * numSamples);
+    }
+  }
+
+  m_trace.end("cycle");
+  m_cycles.fetch_add(1, std::memory_order_release);
+}
+
+// Applies the messages due before the frame until. Returns whether a message
+// is due later in the cycle, and if so sets next to its frame.
+bool ProcessorRunner::applyParameters(AudioProcessor& processor, std::uint32_t cycleStart, std::uint32_t until, std::uint32_t& next)
+{
+  ParameterMessage message;
+  auto applied = false;
+  auto pending = false;
+
+  while (::jack_ringbuffer_peek(
+        m_ringBuffer,
+        reinterpret_cast<char *>(&message),
+        sizeof(message)) == sizeof(message))
+  {
+    // Messages are applied in order, so a pending batch holds back the rest.
+    // Released batches are due at once.
+    if (message.gate && !message.gate->isReleased(message.batch, cycleStart))
+    {
+      break;
+    }
+
+    if (!message.gate && static_cast<std::int32_t>(message.frame - until) >= 0)
+    {
+      pending = true;
+      next = message.frame;
+      break;
+    }
+
+    if (!applied)
+    {
+      m_trace.begin("parameters");
+      applied = true;
+    }
+
+    ::jack_ringbuffer_read_advance(m_ringBuffer, sizeof(message));
+
+    RtScope scope(m_activeName.load(std::memory_order_relaxed));
+    if (message.isPrepared)
+    {
+      processor.applyParameter(message.prepared);
+    }
+    else
+    {
+      processor.setParameter(message.parameter);
+    }
+  }
+
+  if (applied)
+  {
+    m_trace.end("parameters");
+  }
+
+  return pending;
+}
+
+void ProcessorRunner::processBlock(AudioProcessor& processor, std::uint32_t numSamples)
+{
+  auto& in = m_inputs;
+  auto& out = m_outputs;
+  const auto numChannels = out.size();
+
+  m_trace.begin("process");
+  {
+    RtScope scope(m_activeName.load(std::memory_order_relaxed));
+    // A new processor has not run mono yet
+    if (&processor != m_lastProcessor)
+    {
+      m_lastProcessor = &processor;
+      m_ranMono = false;
+    }
+
+    if (numChannels == 2 && m_monoInput.load(std::memory_order_relaxed) && processor.preservesMono())
+    {
+      processor.processMono(in[0], out[0], numSamples);
+      std::memcpy(out[1], out[0], sizeof(Sample) * numSamples);
+      m_ranMono = true;
+    }
+    else if (numChannels == 2)
+    {
+      if (m_ranMono)
+      {
+        processor.leaveMono();
+        m_ranMono = false;
+      }
+      processor.process(in[0], in[1], out[0], out[1], numSamples);
+    }
+    else
+    {
+      processor.processChannels(in.data(), out.data(), numChannels, numSamples);
+    }
+  }
+  m_trace.end("process");
+}
+
+void ProcessorRunner::setProcessor(AudioProcessor::Ptr processor, const std::string& name)
+{
+  destroyRetired();
+
+  auto previousName = std::exchange(m_processorName, std::make_unique<std::string>(name));
+  m_activeName.store(m_processorName->c_str(), std::memory_order_relaxed);
+
+  auto previous = std::exchange(m_processor, std::move(processor));
+  m_active.store(m_processor.get(), std::memory_order_release);
+  m_latency.store(m_processor ? m_processor->getLatency() : 0, std::memory_order_relaxed);
+
+  // The name is only read while a processor is set
+  const auto cycles = m_cycles.load(std::memory_order_acquire);
+  if (previous && !waitForCycleSince(cycles, std::chrono::steady_clock::now() + CycleTimeout))
+  {
+    // Process may be stalled inside the previous processor
+    m_retired.push_back({std::move(previous), std::move(previousName), cycles});
+  }
+}
+
+void ProcessorRunner::destroyRetired()
+{
+  const auto cycles = m_cycles.load(std::memory_order_acquire);
+  m_retired.erase(
+      std::remove_if(m_retired.begin(), m_retired.end(), [cycles](auto& retired) { return retired.cycles != cycles; }),
+      m_retired.end());
+}
+
+bool ProcessorRunner::waitForCycle() const
+{
+  // A cycle completing after this point means no callback is still running
+  // with state that was changed before it
+  return waitForCycleSince(m_cycles.load(std::memory_order_acquire), std::chrono::steady_clock::now() + CycleTimeout);
+}
+
+bool ProcessorRunner::waitForCycleSince(std::uint32_t cycles, std::chrono::steady_clock::time_point deadline) const
+{
+  while (m_cycles.load(std::memory_order_acquire) == cycles)
+  {
+    if (std::chrono::steady_clock::now() > deadline)
+    {
+      printf("Warning: No process cycle within timeout\n");
+      return false;
+    }
+    std::this_thread::sleep_for(std::chrono::microseconds(500));
+  }
+  return true;
+}
+
+void ProcessorRunner::writeMessage(const AudioProcessor::Parameter& parameter, const ParameterBatchGate* gate, std::uint32_t batch, std::uint32_t frame)
+{
+  static_assert(std::is_trivially_copyable<ParameterMessage>::value, "Parameter messages are copied bytewise");
+
+  ParameterMessage message{parameter, gate, batch, frame, false, {}};
+  if (m_processor)
+  {
+    message.isPrepared = m_processor->prepareParameter(parameter, message.prepared);
+  }
+
+  if (::jack_ringbuffer_write_space(m_ringBuffer) < sizeof(message))
+  {
+    throw std::runtime_error("Failed to write parameter to ringbuffer");
+  }
+
+  ::jack_ringbuffer_write(
+      m_ringBuffer,
+      reinterpret_cast<const char *>(&message),
+      sizeof(message));
+}
+
+std::size_t ProcessorRunner::getNumChannels() const
+{
+  return m_outputs.size();
+}
+
+std::uint32_t ProcessorRunner::getLatency() const
+{
+  return m_latency.load(std::memory_order_relaxed);
+}
+
+bool ProcessorRunner::preservesMono() const
+{
+  // Batch slots are channels, not a stereo pair
+  return getNumChannels() == 2 && m_processor && m_processor->preservesMono();
+}
+
+void ProcessorRunner::setMonoInput(bool mono)
+{
+  m_monoInput.store(mono, std::memory_order_relaxed);
+}
+
+LevelMeter::Levels ProcessorRunner::readLevels()
+{
+  return m_meter.read();
+}
+
+void ProcessorRunner::reset()
+{
+  // Stopping the trace is safe at any time
+  m_trace.stop();
+
+  // Process only meters with a processor, and a retired one may still be
+  // running
+  if (m_processor || !m_retired.empty())
+  {
+    return;
+  }
+
+  m_meter.reset();
+}
+
+void ProcessorRunner::startTrace()
+{
+  m_trace.start();
+}
+
+void ProcessorRunner::stopTrace()
+{
+  m_trace.stop();
+  m_traceStopCycles = m_cycles.load(std::memory_order_acquire);
+}
+
+std::vector<TraceBuffer::Event> ProcessorRunner::readTrace(std::chrono::steady_clock::time_point deadline) const
+{
+  if (!waitForCycleSince(m_traceStopCycles, deadline))
+  {
+    return {};
+  }
+  return m_trace.read();
+}
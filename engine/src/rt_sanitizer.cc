@@ -0,0 +1,211 @@
+#include <rt_sanitizer.h>
+#include <cerrno>
+#include <cstdarg>
+#include <cstddef>
+#include <cstring>
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+
+// Interposes the allocator, mutexes and common blocking syscalls for the
+// whole process. Outside of an RtScope everything is forwarded untouched.
+
+extern "C"
+{
+  void* __libc_malloc(std::size_t size);
+  void* __libc_calloc(std::size_t count, std::size_t size);
+  void* __libc_realloc(void* ptr, std::size_t size);
+  void* __libc_memalign(std::size_t alignment, std::size_t size);
+  void __libc_free(void* ptr);
+}
+
+namespace
+{
+
+thread_local int t_depth = 0;
+thread_local const char* t_context = nullptr;
+thread_local bool t_reporting = false;
+
+template<typename T>
+T next(const char* symbol)
+{
+  return reinterpret_cast<T>(::dlsym(RTLD_NEXT, symbol));
+}
+
+struct RealFunctions
+{
+  int (*mutexLock)(pthread_mutex_t*) = next<int (*)(pthread_mutex_t*)>("pthread_mutex_lock");
+  int (*condWait)(pthread_cond_t*, pthread_mutex_t*) = next<int (*)(pthread_cond_t*, pthread_mutex_t*)>("pthread_cond_wait");
+  int (*nanosleep)(const timespec*, timespec*) = next<int (*)(const timespec*, timespec*)>("nanosleep");
+  int (*usleep)(useconds_t) = next<int (*)(useconds_t)>("usleep");
+  int (*open)(const char*, int, ...) = next<int (*)(const char*, int, ...)>("open");
+  ssize_t (*read)(int, void*, std::size_t) = next<ssize_t (*)(int, void*, std::size_t)>("read");
+  ssize_t (*write)(int, const void*, std::size_t) = next<ssize_t (*)(int, const void*, std::size_t)>("write");
+};
+
+RealFunctions& real()
+{
+  static RealFunctions functions;
+  return functions;
+}
+
+void print(const char* text)
+{
+  ::syscall(SYS_write, STDERR_FILENO, text, std::strlen(text));
+}
+
+void report(const char* what)
+{
+  if (t_depth == 0 || t_reporting)
+  {
+    return;
+  }
+
+  t_reporting = true;
+  print("RT violation: ");
+  print(what);
+  print(" in ");
+  print(t_context ? t_context : "unknown");
+  print("\n");
+
+  void* frames[32];
+  auto count = ::backtrace(frames, 32);
+  ::backtrace_symbols_fd(frames, count, STDERR_FILENO);
+  t_reporting = false;
+}
+
+// backtrace() loads libgcc on first use, which must not happen on the RT thread
+__attribute__((constructor)) void initialize()
+{
+  void* frames[1];
+  ::backtrace(frames, 1);
+  real();
+}
+
+}
+
+namespace awesomefx
+{
+namespace rtsan
+{
+
+void enter(const char* context)
+{
+  if (t_depth++ == 0)
+  {
+    t_context = context;
+  }
+}
+
+void leave()
+{
+  if (--t_depth == 0)
+  {
+    t_context = nullptr;
+  }
+}
+
+}
+}
+
+extern "C"
+{
+
+void* malloc(std::size_t size)
+{
+  report("malloc");
+  return __libc_malloc(size);
+}
+
+void* calloc(std::size_t count, std::size_t size)
+{
+  report("calloc");
+  return __libc_calloc(count, size);
+}
+
+void* realloc(void* ptr, std::size_t size)
+{
+  report("realloc");
+  return __libc_realloc(ptr, size);
+}
+
+void free(void* ptr)
+{
+  if (ptr)
+  {
+    report("free");
+  }
+  __libc_free(ptr);
+}
+
+int posix_memalign(void** ptr, std::size_t alignment, std::size_t size)
+{
+  report("posix_memalign");
+  *ptr = __libc_memalign(alignment, size);
+  return *ptr ? 0 : ENOMEM;
+}
+
+void* aligned_alloc(std::size_t alignment, std::size_t size)
+{
+  report("aligned_alloc");
+  return __libc_memalign(alignment, size);
+}
+
+int pthread_mutex_lock(pthread_mutex_t* mutex)
+{
+  report("pthread_mutex_lock");
+  return real().mutexLock(mutex);
+}
+
+int pthread_cond_wait(pthread_cond_t* cond, pthread_mutex_t* mutex)
+{
+  report("pthread_cond_wait");
+  return real().condWait(cond, mutex);
+}
+
+int nanosleep(const timespec* request, timespec* remaining)
+{
+  report("nanosleep");
+  return real().nanosleep(request, remaining);
+}
+
+int usleep(useconds_t usec)
+{
+  report("usleep");
+  return real().usleep(usec);
+}
+
+int open(const char* path, int flags, ...)
+{
+  report("open");
+
+  mode_t mode = 0;
+  if (flags & (O_CREAT | O_TMPFILE))
+  {
+    va_list args;
+    va_start(args, flags);
+    mode = va_arg(args, mode_t);
+    va_end(args);
+  }
+
+  return real().open(path, flags, mode);
+}
+
+ssize_t read(int fd, void* buffer, std::size_t count)
+{
+  report("read");
+  return real().read(fd, buffer, count);
+}
+
+ssize_t write(int fd, const void* buffer, std::size_t count)
+{
+  report("write");
+  return real().write(fd, buffer, count);
+}
+
+}
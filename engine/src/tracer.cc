@@ -0,0 +1,42 @@
+#include <tracer.h>
+#include <algorithm>
+
+using namespace awesomefx;
+
+TraceBuffer::TraceBuffer(std::size_t capacity)
+{
+  auto size = std::size_t{1};
+  while (size < capacity)
+  {
+    size <<= 1;
+  }
+
+  m_events = std::make_unique<Event[]>(size);
+  m_mask = size - 1;
+}
+
+void TraceBuffer::start()
+{
+  m_written.store(0, std::memory_order_relaxed);
+  m_enabled.store(true, std::memory_order_release);
+}
+
+void TraceBuffer::stop()
+{
+  m_enabled.store(false, std::memory_order_release);
+}
+
+std::vector<TraceBuffer::Event> TraceBuffer::read() const
+{
+  auto written = m_written.load(std::memory_order_acquire);
+  auto count = std::min(written, m_mask + 1);
+
+  std::vector<Event> events;
+  events.reserve(count);
+  for (auto i = written - count; i < written; ++i)
+  {
+    events.push_back(m_events[i & m_mask]);
+  }
+
+  return events;
+}
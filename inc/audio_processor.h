@@ -1,11 +1,14 @@
 #ifndef AUDIO_PROCESSOR_H
 #define AUDIO_PROCESSOR_H
 
+#include <array>
 #include <cstddef>
 #include <memory>
 #include <functional>
 #include <string>
 #include <cstdint>
+#include <cstring>
+#include <type_traits>
 
 namespace awesomefx
 {
@@ -31,11 +34,80 @@ class AudioProcessor
       float value;
     };
 
+    // Whatever a processor derives from a parameter value, e.g. filter
+    // coefficients. Plain data, it is copied through the parameter queue.
+    struct PreparedParameter
+    {
+      std::uint32_t index;
+      std::array<float, 8> values;
+
+      template<typename T>
+      void set(const T& payload)
+      {
+        static_assert(std::is_trivially_copyable<T>::value && sizeof(T) <= sizeof(values), "Payload must fit as plain data");
+        std::memcpy(values.data(), &payload, sizeof(T));
+      }
+
+      template<typename T>
+      T get() const
+      {
+        static_assert(std::is_trivially_copyable<T>::value && sizeof(T) <= sizeof(values), "Payload must fit as plain data");
+        T payload;
+        std::memcpy(&payload, values.data(), sizeof(T));
+        return payload;
+      }
+    };
+
     virtual ~AudioProcessor() {}
 
     virtual void process(Sample* in_l, Sample* in_r, Sample* out_l, Sample* out_r, std::size_t numSamples) = 0;
     virtual void setParameter(const Parameter& param) = 0;
 
+    // Optional two phase update keeping expensive math off the RT thread.
+    // prepareParameter runs on the control thread while the processor may be
+    // processing, so it must not touch anything process uses. Calls are
+    // serialised, so it may keep control side state of its own. Returning
+    // true makes the RT thread call applyParameter with the result instead
+    // of setParameter.
+    virtual bool prepareParameter(const Parameter& /*param*/, PreparedParameter& /*prepared*/) const
+    {
+      return false;
+    }
+
+    virtual void applyParameter(const PreparedParameter& /*prepared*/) {}
+
+    // Whether equal left and right inputs always give equal outputs. Must not
+    // change over the lifetime of the processor. Stereo slots fed a mono
+    // signal then call processMono instead of process and copy its output to
+    // the right channel.
+    virtual bool preservesMono() const
+    {
+      return false;
+    }
+
+    // Samples by which the output lags the input, e.g. for lookahead. A
+    // processor with latency delays its own dry signal to match. Must not
+    // change over the lifetime of the processor.
+    virtual std::uint32_t getLatency() const
+    {
+      return 0;
+    }
+
+    // Processes the left channel alone. Right channel state is left as it
+    // was until leaveMono.
+    virtual void processMono(Sample* /*in*/, Sample* /*out*/, std::size_t /*numSamples*/) {}
+
+    // Called before the first process after processMono. Processors with
+    // per-channel state bring the right channel up to date from the left,
+    // which has been running on the signal of both.
+    virtual void leaveMono() {}
+
+    // Slots with other than two channels call this instead of process. Every
+    // channel is an independent mono instance and they all share the
+    // parameters. Only processors from FxPlugin::createBatchProcessor are run
+    // this way.
+    virtual void processChannels(const Sample* const* /*in*/, Sample* const* /*out*/, std::size_t /*numChannels*/, std::size_t /*numSamples*/) {}
+
 };
 
 }
@@ -23,6 +23,14 @@ class FxPlugin
 
     virtual FxPluginInfo getPluginInfo() const = 0;
     virtual AudioProcessor::Ptr createAudioProcessor(const AudioProcessingContext& context) const = 0;
+
+    // Optional, runs numChannels instances in lockstep, e.g. with the state of
+    // one channel per vector lane. Returning nullptr makes the engine run a
+    // stereo processor per channel pair instead.
+    virtual AudioProcessor::Ptr createBatchProcessor(const AudioProcessingContext& /*context*/, std::size_t /*numChannels*/) const
+    {
+      return nullptr;
+    }
 };
 
 }
@@ -0,0 +1,209 @@
+#include <cstdio>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <complex>
+#include <random>
+#include <algorithm>
+#include <boost/program_options.hpp>
+#include <fft.h>
+
+namespace po = boost::program_options;
+
+using namespace awesomefx;
+
+// Checks the FFTs against a naive DFT in double precision and times both.
+// Errors are relative to the largest bin of the reference spectrum, the
+// round trip error relative to the largest input sample.
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+using Spectrum = std::vector<std::complex<double>>;
+
+Spectrum dft(const std::vector<float>& re, const std::vector<float>& im)
+{
+  const auto size = re.size();
+  Spectrum spectrum(size);
+  for (auto k = 0U; k < size; ++k)
+  {
+    std::complex<double> sum = 0;
+    for (auto n = 0U; n < size; ++n)
+    {
+      // Reduced mod size, so the angle stays accurate for large k * n
+      const auto theta = -2 * M_PI * ((static_cast<std::uint64_t>(k) * n) % size) / size;
+      sum += std::complex<double>(re[n], im[n]) * std::polar(1.0, theta);
+    }
+    spectrum[k] = sum;
+  }
+  return spectrum;
+}
+
+double spectrumError(const Spectrum& reference, const float* re, const float* im, std::size_t bins)
+{
+  double peak = 0;
+  double error = 0;
+  for (auto k = 0U; k < bins; ++k)
+  {
+    peak = std::max(peak, std::abs(reference[k]));
+    error = std::max(error, std::abs(reference[k] - std::complex<double>(re[k], im[k])));
+  }
+  return peak > 0 ? error / peak : error;
+}
+
+double signalError(const std::vector<float>& reference, const std::vector<float>& signal, double scale)
+{
+  double peak = 0;
+  double error = 0;
+  for (auto n = 0U; n < reference.size(); ++n)
+  {
+    peak = std::max<double>(peak, std::abs(reference[n]));
+    error = std::max<double>(error, std::abs(reference[n] - signal[n] * scale));
+  }
+  return peak > 0 ? error / peak : error;
+}
+
+// Runs f until duration has passed, returns the mean time of a call in us
+template<typename F>
+double timeIt(double duration, F&& f)
+{
+  std::size_t calls = 0;
+  const auto start = Clock::now();
+  auto elapsed = 0.0;
+  do
+  {
+    f();
+    ++calls;
+    elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+  } while (elapsed < duration);
+  return 1e6 * elapsed / calls;
+}
+}
+
+int main(int argc, char *argv[])
+{
+  po::options_description desc("Allowed options");
+  desc.add_options()
+    ("help", "produce help message")
+    ("min-size", po::value<std::uint32_t>(), "set the smallest transform size, a power of two")
+    ("max-size", po::value<std::uint32_t>(), "set the largest transform size, a power of two")
+    ("max-dft-size", po::value<std::uint32_t>(), "set the largest size the naive DFT is timed at")
+    ("tolerance", po::value<double>(), "set the relative error that fails the check")
+    ("duration", po::value<double>(), "set seconds each transform is timed for")
+    ;
+
+  po::variables_map vm;
+  po::store(po::parse_command_line(argc, argv, desc), vm);
+  po::notify(vm);
+
+  if (vm.count("help")) {
+    std::cout << desc;
+    return 0;
+  }
+
+  std::uint32_t minSize{4};
+  std::uint32_t maxSize{8192};
+  std::uint32_t maxDftSize{1024};
+  double tolerance{1e-5};
+  double duration{0.2};
+
+  if (vm.count("min-size"))
+  {
+    minSize = std::max(4U, vm["min-size"].as<std::uint32_t>());
+  }
+
+  if (vm.count("max-size"))
+  {
+    maxSize = vm["max-size"].as<std::uint32_t>();
+  }
+
+  if (vm.count("max-dft-size"))
+  {
+    maxDftSize = vm["max-dft-size"].as<std::uint32_t>();
+  }
+
+  if (vm.count("tolerance"))
+  {
+    tolerance = vm["tolerance"].as<double>();
+  }
+
+  if (vm.count("duration"))
+  {
+    duration = vm["duration"].as<double>();
+  }
+
+  if ((minSize & (minSize - 1)) || (maxSize & (maxSize - 1)))
+  {
+    std::cerr << "Sizes must be powers of two\n";
+    return 1;
+  }
+
+  std::mt19937 generator(1);
+  std::uniform_real_distribution<float> distribution(-1, 1);
+
+  printf("%6s %12s %12s %12s %12s %12s %12s %12s\n",
+      "size", "cplx error", "cplx trip", "real error", "real trip", "cplx us", "real us", "dft us");
+
+  auto failed = false;
+  for (auto size = minSize; size <= maxSize; size *= 2)
+  {
+    std::vector<float> inRe(size), inIm(size), zeros(size, 0.0f);
+    std::generate(inRe.begin(), inRe.end(), [&] { return distribution(generator); });
+    std::generate(inIm.begin(), inIm.end(), [&] { return distribution(generator); });
+
+    const auto complexReference = dft(inRe, inIm);
+    const auto realReference = dft(inRe, zeros);
+
+    dsp::ComplexFft complexFft(size);
+    auto re = inRe, im = inIm;
+    complexFft.forward(re.data(), im.data());
+    const auto complexError = spectrumError(complexReference, re.data(), im.data(), size);
+    complexFft.inverse(re.data(), im.data());
+    const auto complexTrip = std::max(signalError(inRe, re, 1.0 / size), signalError(inIm, im, 1.0 / size));
+
+    dsp::RealFft realFft(size);
+    std::vector<float> binsRe(realFft.bins()), binsIm(realFft.bins()), out(size);
+    realFft.forward(inRe.data(), binsRe.data(), binsIm.data());
+    const auto realError = spectrumError(realReference, binsRe.data(), binsIm.data(), realFft.bins());
+    realFft.inverse(binsRe.data(), binsIm.data(), out.data());
+    const auto realTrip = signalError(inRe, out, 1);
+
+    // Transforms of transforms grow without bound, so every call starts over
+    const auto complexTime = timeIt(duration, [&] {
+      std::copy(inRe.begin(), inRe.end(), re.begin());
+      std::copy(inIm.begin(), inIm.end(), im.begin());
+      complexFft.forward(re.data(), im.data());
+    });
+    const auto realTime = timeIt(duration, [&] {
+      realFft.forward(inRe.data(), binsRe.data(), binsIm.data());
+    });
+
+    printf("%6u %12.3g %12.3g %12.3g %12.3g %12.2f %12.2f",
+        size, complexError, complexTrip, realError, realTrip, complexTime, realTime);
+    if (size <= maxDftSize)
+    {
+      printf(" %12.2f", timeIt(duration, [&] { dft(inRe, inIm); }));
+    }
+    else
+    {
+      printf(" %12s", "-");
+    }
+
+    const auto worst = std::max({complexError, complexTrip, realError, realTrip});
+    if (!(worst <= tolerance))
+    {
+      printf("  FAILED");
+      failed = true;
+    }
+    printf("\n");
+  }
+
+  if (failed)
+  {
+    printf("\nErrors above the tolerance of %g\n", tolerance);
+    return 1;
+  }
+}
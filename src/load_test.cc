@@ -0,0 +1,291 @@
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <memory>
+#include <boost/program_options.hpp>
+#include <audio_processor.h>
+#include <fx_plugin.h>
+#include <fx_plugin_handler.h>
+#include <instance_batch.h>
+#include <null_backend.h>
+
+namespace po = boost::program_options;
+
+using namespace awesomefx;
+
+// Finds how much of a plugin mix one core sustains: runs the engine on the
+// null backend and keeps adding slots, either appending the mix's plugins
+// to one chain in turn or adding whole chains of the mix side by side,
+// until the p99 cycle time passes the given fraction of the period.
+
+namespace
+{
+
+struct Step
+{
+  std::size_t slots;
+  std::size_t chains;
+  double p99;
+  double max;
+  std::uint32_t overruns;
+};
+
+// The cycle time a fraction of the cycles stay under, in periods
+double percentile(const std::vector<std::uint32_t>& histogram, double fraction)
+{
+  std::uint64_t total = 0;
+  for (auto count : histogram)
+  {
+    total += count;
+  }
+
+  std::uint64_t count = 0;
+  for (auto bin = 0U; bin < histogram.size(); ++bin)
+  {
+    count += histogram[bin];
+    if (count >= fraction * total)
+    {
+      return (bin + 1.0) / NullBackend::HistogramResolution;
+    }
+  }
+  return static_cast<double>(NullBackend::HistogramPeriods);
+}
+
+double maximum(const std::vector<std::uint32_t>& histogram)
+{
+  for (auto bin = histogram.size(); bin > 0; --bin)
+  {
+    if (histogram[bin - 1])
+    {
+      return static_cast<double>(bin) / NullBackend::HistogramResolution;
+    }
+  }
+  return 0;
+}
+}
+
+int main(int argc, char *argv[])
+{
+  po::options_description desc("Allowed options");
+  desc.add_options()
+    ("help", "produce help message")
+    ("plugin-dir", po::value<std::string>(), "set plugin directory")
+    ("plugins", po::value<std::vector<std::string>>()->multitoken(), "set the plugin mix, appended in turn")
+    ("mode", po::value<std::string>(), "set how the load grows: append to one chain or replicate the chain")
+    ("channels", po::value<std::uint32_t>(), "set channels per slot")
+    ("sample-rate", po::value<std::uint32_t>(), "set sample rate")
+    ("period", po::value<std::uint32_t>(), "set period size")
+    ("threshold", po::value<double>(), "set the fraction of the period the p99 cycle time may take")
+    ("step-duration", po::value<double>(), "set seconds measured per step")
+    ("max-slots", po::value<std::uint32_t>(), "set the number of slots to stop at")
+    ("rt-priority", po::value<int>(), "set SCHED_FIFO priority of the timer thread, 0 for none")
+    ;
+
+  po::variables_map vm;
+  po::store(po::parse_command_line(argc, argv, desc), vm);
+  po::notify(vm);
+
+  if (vm.count("help") || !vm.count("plugins")) {
+    std::cout << desc;
+    return vm.count("help") ? 0 : 1;
+  }
+
+  std::string pluginDir{"effects"};
+  auto mix = vm["plugins"].as<std::vector<std::string>>();
+  std::string mode{"append"};
+  std::uint32_t channels{2};
+  NullBackend::Settings settings;
+  settings.noise = true;
+  double threshold{0.7};
+  double stepDuration{2};
+  std::uint32_t maxSlots{256};
+
+  if (vm.count("plugin-dir"))
+  {
+    pluginDir = vm["plugin-dir"].as<std::string>();
+  }
+
+  if (vm.count("mode"))
+  {
+    mode = vm["mode"].as<std::string>();
+  }
+
+  if (vm.count("channels"))
+  {
+    channels = std::max(1U, vm["channels"].as<std::uint32_t>());
+  }
+
+  if (vm.count("sample-rate"))
+  {
+    settings.sampleRate = vm["sample-rate"].as<std::uint32_t>();
+  }
+
+  if (vm.count("period"))
+  {
+    settings.periodSize = vm["period"].as<std::uint32_t>();
+  }
+
+  if (vm.count("threshold"))
+  {
+    threshold = vm["threshold"].as<double>();
+  }
+
+  if (vm.count("step-duration"))
+  {
+    stepDuration = vm["step-duration"].as<double>();
+  }
+
+  if (vm.count("max-slots"))
+  {
+    maxSlots = vm["max-slots"].as<std::uint32_t>();
+  }
+
+  if (vm.count("rt-priority"))
+  {
+    settings.priority = vm["rt-priority"].as<int>();
+  }
+
+  if (mode != "append" && mode != "replicate")
+  {
+    std::cerr << "Unknown mode: " << mode << "\n";
+    return 1;
+  }
+
+  FxPluginHandlerImpl pluginHandler(pluginDir);
+  std::vector<const FxPlugin*> plugins;
+  for (auto& name : mix)
+  {
+    plugins.push_back(&pluginHandler.getPlugin(name));
+  }
+
+  const auto replicate = mode == "replicate";
+  const auto deadline = 1e6 * settings.periodSize / settings.sampleRate;
+
+  // Declared before the slots, which must not outlive it
+  NullBackend backend(settings);
+  std::vector<AudioClient::Ptr> slots;
+  // The last slot of every chain
+  std::vector<AudioClient*> chainEnds;
+
+  auto addSlot = [&](std::size_t index, AudioClient* source) {
+    auto& plugin = *plugins[index];
+    auto client = backend.createClient(mix[index], [&plugin, channels](auto& context) {
+      return createSlotProcessor(plugin, context, channels);
+    }, channels);
+
+    if (source)
+    {
+      source->disconnectOutputsFromPlaybackPorts();
+      client->connectInputs(source->getOutputPorts());
+    }
+    else
+    {
+      client->connectInputsToCapturePorts({}, false);
+    }
+    client->connectOutputsToPlaybackPorts();
+
+    slots.push_back(std::move(client));
+    return slots.back().get();
+  };
+
+  auto grow = [&] {
+    if (replicate)
+    {
+      AudioClient* source = nullptr;
+      for (auto i = 0U; i < plugins.size(); ++i)
+      {
+        source = addSlot(i, source);
+      }
+      chainEnds.push_back(source);
+    }
+    else
+    {
+      auto source = chainEnds.empty() ? nullptr : chainEnds.back();
+      chainEnds.assign(1, addSlot(slots.size() % plugins.size(), source));
+    }
+  };
+
+  printf("\nPeriod %u at %u Hz, deadline %.0f us, threshold %.0f us\n\n",
+      settings.periodSize, settings.sampleRate, deadline, threshold * deadline);
+
+  std::vector<Step> steps;
+  auto crossed = false;
+  while (slots.size() + (replicate ? plugins.size() : 1) <= maxSlots)
+  {
+    grow();
+
+    // Let the new slots warm up before they are measured
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    auto before = backend.readCycleTimes();
+    auto overruns = backend.getOverruns();
+    std::this_thread::sleep_for(std::chrono::duration<double>(stepDuration));
+    auto after = backend.readCycleTimes();
+
+    std::vector<std::uint32_t> histogram(after.size());
+    for (auto bin = 0U; bin < after.size(); ++bin)
+    {
+      histogram[bin] = after[bin] - before[bin];
+    }
+
+    Step step{slots.size(), chainEnds.size(), percentile(histogram, 0.99), maximum(histogram), backend.getOverruns() - overruns};
+    printf("%3zu slots in %3zu chains: p99 %8.1f us (%5.1f%%), max %8.1f us, %u overruns\n",
+        step.slots, step.chains, step.p99 * deadline, 100 * step.p99, step.max * deadline, step.overruns);
+
+    // Overruns are reported but do not end the test, without RT priority
+    // they are as likely to be wakeups the scheduler delayed
+    if (step.p99 > threshold)
+    {
+      crossed = true;
+      break;
+    }
+    steps.push_back(step);
+  }
+
+  // Slots go before the backend does
+  slots.clear();
+
+  if (steps.empty() && !crossed)
+  {
+    printf("\nNo %s fits within --max-slots\n", replicate ? "chain" : "slot");
+    return 1;
+  }
+
+  if (steps.empty())
+  {
+    printf("\nNot even one %s is sustainable\n", replicate ? "chain" : "slot");
+    return 1;
+  }
+
+  auto& best = steps.back();
+  printf(crossed ? "\nMaximum sustainable: " : "\nSlot limit reached, sustainable at least: ");
+  if (replicate)
+  {
+    printf("%zu chains of", best.chains);
+    for (auto& name : mix)
+    {
+      printf(" %s", name.c_str());
+    }
+    printf(" (%zu slots)", best.slots);
+  }
+  else
+  {
+    printf("a chain of %zu slots (", best.slots);
+    for (auto i = 0U; i < mix.size() && i < best.slots; ++i)
+    {
+      // Slots take the plugins of the mix in turn
+      printf("%s%zu %s", i ? ", " : "", (best.slots - i + mix.size() - 1) / mix.size(), mix[i].c_str());
+    }
+    printf(")");
+  }
+  printf(", %u channels each\np99 cycle time %.1f us, %.1f%% of the period\n",
+      channels, best.p99 * deadline, 100 * best.p99);
+
+  if (!crossed)
+  {
+    printf("The threshold was not crossed, raise --max-slots to find the ceiling\n");
+  }
+}
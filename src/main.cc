@@ -3,11 +3,19 @@
 #include <cstdlib>
 #include <string>
 #include <vector>
+#include <thread>
+#include <algorithm>
 #include <dlfcn.h>
 #include <boost/asio/io_context.hpp>
 #include <boost/asio/executor_work_guard.hpp>
-#include <jack_client.h>
+#include <audio_backend.h>
+#include <jack_backend.h>
+#include <null_backend.h>
+#ifdef AWESOMEFX_ALSA
+#include <alsa_backend.h>
+#endif
 #include <memory>
+#include <stdexcept>
 #include <boost/program_options.hpp>
 #include <audio_processor.h>
 #include <fx_plugin.h>
@@ -24,10 +32,23 @@ int main(int argc, char *argv[])
   po::options_description desc("Allowed options");
   desc.add_options()
     ("help", "produce help message")
-    ("input-ports", po::value<std::vector<std::string>>()->multitoken(), "set jack input ports")
+    ("input-ports", po::value<std::vector<std::string>>()->multitoken(), "set capture ports")
     ("plugin-dir", po::value<std::vector<std::string>>(), "set plugin directory")
     ("backend-port", po::value<std::uint32_t>(), "set backend port")
+    ("io-threads", po::value<std::uint32_t>(), "set number of backend io threads")
+    ("client-pool", po::value<std::uint32_t>(), "set number of pre-opened jack clients")
+    ("backend", po::value<std::string>(), "set audio backend: jack, alsa or null")
+    ("sample-rate", po::value<std::uint32_t>(), "set sample rate of the alsa and null backends")
+    ("period", po::value<std::uint32_t>(), "set period size of the alsa and null backends")
+    ("rt-priority", po::value<int>(), "set SCHED_FIFO priority of the alsa and null backend thread, 0 for none")
+    ("ir-dir", po::value<std::string>(), "set impulse response directory for the convolution plugin")
     ;
+#ifdef AWESOMEFX_ALSA
+  desc.add_options()
+    ("periods", po::value<std::uint32_t>(), "set number of periods of the alsa backend")
+    ("alsa-device", po::value<std::string>(), "set device of the alsa backend")
+    ;
+#endif
 
   po::variables_map vm;
   po::store(po::parse_command_line(argc, argv, desc), vm);
@@ -41,6 +62,12 @@ int main(int argc, char *argv[])
   std::vector<std::string> inputs;
   std::string pluginDir{"effects"};
   std::uint32_t backendPort{5396};
+  std::uint32_t ioThreads{2};
+  std::uint32_t clientPoolSize{4};
+  std::string backendName{"jack"};
+  std::uint32_t sampleRate{48000};
+  std::uint32_t periodSize{256};
+  int rtPriority{0};
 
   if (vm.count("input-ports"))
   {
@@ -57,14 +84,91 @@ int main(int argc, char *argv[])
     backendPort = vm["backend-port"].as<std::uint32_t>();
   }
 
-  boost::asio::io_context io_context;
+  if (vm.count("io-threads"))
+  {
+    ioThreads = std::max(1U, vm["io-threads"].as<std::uint32_t>());
+  }
+
+  if (vm.count("client-pool"))
+  {
+    clientPoolSize = vm["client-pool"].as<std::uint32_t>();
+  }
+
+  if (vm.count("backend"))
+  {
+    backendName = vm["backend"].as<std::string>();
+  }
+
+  if (vm.count("sample-rate"))
+  {
+    sampleRate = vm["sample-rate"].as<std::uint32_t>();
+  }
+
+  if (vm.count("period"))
+  {
+    periodSize = vm["period"].as<std::uint32_t>();
+  }
+
+  if (vm.count("rt-priority"))
+  {
+    rtPriority = vm["rt-priority"].as<int>();
+  }
+
+#ifdef AWESOMEFX_ALSA
+  std::uint32_t periods{2};
+  std::string alsaDevice{"hw:0"};
+
+  if (vm.count("periods"))
+  {
+    periods = vm["periods"].as<std::uint32_t>();
+  }
+
+  if (vm.count("alsa-device"))
+  {
+    alsaDevice = vm["alsa-device"].as<std::string>();
+  }
+#endif
+
+  // Plugins only see the sample rate, so the directory is passed through the environment
+  if (vm.count("ir-dir"))
+  {
+    ::setenv("AWESOMEFX_IR_DIR", vm["ir-dir"].as<std::string>().c_str(), 1);
+  }
+
+  boost::asio::io_context io_context(ioThreads);
   auto work = boost::asio::make_work_guard(io_context);
 
-  auto configBackend = std::make_unique<ConfigurationBackendImpl>(io_context);
+  // Heavy operations (chain rebuilds, plugin reloads) run here, one at a time
+  boost::asio::io_context worker_context(1);
+  auto workerWork = boost::asio::make_work_guard(worker_context);
+  std::thread worker([&worker_context] { worker_context.run(); });
+
+  auto configBackend = std::make_unique<ConfigurationBackendImpl>(io_context, worker_context);
   configBackend->start(backendPort);
 
-  auto jackClientFactory = [](auto& name, auto processor) {
-        return std::make_unique<JackClientImpl>(name, std::move(processor));
+  // Must outlive the controller and thereby every client it hands out
+  AudioBackend::Ptr backend;
+  if (backendName == "jack")
+  {
+    backend = std::make_unique<JackBackend>("awesome-fxd", clientPoolSize);
+  }
+  else if (backendName == "null")
+  {
+    backend = std::make_unique<NullBackend>(NullBackend::Settings{sampleRate, periodSize, 2, rtPriority});
+  }
+#ifdef AWESOMEFX_ALSA
+  else if (backendName == "alsa")
+  {
+    backend = std::make_unique<AlsaBackend>(AlsaBackend::Settings{alsaDevice, sampleRate, periodSize, periods, rtPriority});
+  }
+#endif
+  else
+  {
+    throw std::invalid_argument("Unknown backend: " + backendName);
+  }
+
+  auto clientFactory = [&backend](auto& name, auto processor, auto numChannels) {
+        return backend->createClient(name, processor, numChannels);
   };
 
   auto pluginHandlerFactory = [pluginDir] {
@@ -74,11 +178,26 @@ int main(int argc, char *argv[])
   auto controller = std::make_unique<ControllerImpl>(
       inputs,
       pluginHandlerFactory,
-      jackClientFactory,
+      clientFactory,
       std::move(configBackend)
       );
 
   controller->start();
 
+  std::vector<std::thread> ioPool;
+  for (auto i = 1U; i < ioThreads; ++i)
+  {
+    ioPool.emplace_back([&io_context] { io_context.run(); });
+  }
+
   io_context.run();
+
+  for (auto& thread : ioPool)
+  {
+    thread.join();
+  }
+
+  workerWork.reset();
+  worker_context.stop();
+  worker.join();
 }